@@ -23,6 +23,7 @@ using byte = uint8_t;
 #include <exedit.hpp>
 
 #include "CircleBorder_S.hpp"
+#include "Border_core.hpp"
 
 
 ////////////////////////////////
@@ -34,41 +35,6 @@ namespace Filter::Border
 	{
 		FILTER_INFO("縁取りσ");
 
-		// trackbars.
-		constexpr const char* track_names[]
-			= { "サイズ", "凹半径", "透明度", "内透明度", "ぼかし", "param_a", "画像X", "画像Y" };
-		constexpr int32_t
-			track_den[]			= {    10,   10,   10,   10,   10,   10,     1,     1 },
-			track_min[]			= { -5000,    0,    0,    0,    0,    0, -4000, -4000 },
-			track_min_drag[]	= { -2000,    0,    0,    0,    0,    0, -1000, -1000 },
-			track_default[]		= {    50,    0,    0,    0,    0,  500,     0,     0 },
-			track_max_drag[]	= {  2000, 2000, 1000, 1000, 1000, 1000,  1000,  1000 },
-			track_max[]			= {  5000, 5000, 1000, 1000, 1000, 1000,  4000,  4000 };
-		constexpr int track_link[] = { 0, 0, 0, 0, 0, 0, 1, -1, };
-		namespace idx_track
-		{
-			enum id : int {
-				size,
-				neg_size,
-				transp,
-				f_transp,
-				blur,
-				param_a,
-				img_x,
-				img_y,
-			};
-			constexpr int count_entries = std::size(track_names);
-		};
-
-		static_assert(
-			std::size(track_names) == std::size(track_den) &&
-			std::size(track_names) == std::size(track_min) &&
-			std::size(track_names) == std::size(track_min_drag) &&
-			std::size(track_names) == std::size(track_default) &&
-			std::size(track_names) == std::size(track_max_drag) &&
-			std::size(track_names) == std::size(track_max) &&
-			std::size(track_names) == std::size(track_link));
-
 		// checks.
 		constexpr const char* check_names[]
 			= { gui::algorithm_names, "縁色の設定", "パターン画像ファイル" };
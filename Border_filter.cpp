@@ -11,16 +11,16 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 */
 
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
-
-#define NOMINMAX
-#define WIN32_LEAN_AND_MEAN
-using byte = uint8_t;
-#include <exedit.hpp>
+#include <optional>
 
 #include "multi_thread.hpp"
 #include "buffer_op.hpp"
 #include "tiled_image.hpp"
+#include "incremental.hpp"
+#include "sdf.hpp"
+#include "draft.hpp"
 
 #include "kind_bin/inf_def.hpp"
 #include "kind_bin2x/inf_def.hpp"
@@ -30,10 +30,11 @@ using byte = uint8_t;
 #include "kind_max_fast/inf_def.hpp"
 
 #include "filter_defl.hpp"
-#include "Border.hpp"
+#include "Border_core.hpp"
 
 using namespace Filter::Border;
 using namespace Calculation;
+using Filter::frame;
 namespace Border_filter::params
 {
 	using namespace impl;
@@ -86,25 +87,22 @@ protected:
 			allows_buffer_overlap; // whether intermediate result can overlap final result.
 	};
 
-	static size_t obj_mem_max() {
-		return sizeof(ExEdit::PixelYCA) * ((exedit.yca_max_w + 8) * (exedit.yca_max_h + 4) - 4);
-	}
-	static std::pair<int, int> max_size_cand(size_t pix_max) {
+	static std::pair<int, int> max_size_cand(size_t pix_max, int yca_max_w, int yca_max_h) {
 		int w, h = w = static_cast<int>(std::sqrt(pix_max)) & (-4);
-		if (w < exedit.yca_max_w) {
-			w = (exedit.yca_max_w + 3) & (-4);
+		if (w < yca_max_w) {
+			w = (yca_max_w + 3) & (-4);
 			h = (pix_max / w + 3) & (-4);
 		}
-		else if (h < exedit.yca_max_h) {
-			h = (exedit.yca_max_h + 3) & (-4);
+		else if (h < yca_max_h) {
+			h = (yca_max_h + 3) & (-4);
 			w = (pix_max / h + 3) & (-4);
 		}
 		return { w, h };
 	}
-	virtual std::pair<int, int> max_size() const = 0;
+	virtual std::pair<int, int> max_size(int yca_max_w, int yca_max_h) const = 0;
 	virtual process_spec tell_spec(int sum_size, int neg_size) const = 0;
 
-	// copies alpha values from `efpip->obj_edit` to `efpip->obj_temp`,
+	// copies alpha values from `fr.obj_edit` to `fr.obj_temp`,
 	// in a manner that is contiguous with non-zero-sized filter.
 	virtual void zero_op(int param_a, ExEdit::PixelYCA const* src_buf, size_t src_stride,
 		int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride) const
@@ -117,10 +115,17 @@ protected:
 	}
 	virtual Bounds inflate_1(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t stride,
 		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, void* heap) const = 0;
+	// the first of two passes keeps the summary of its result to `keep_hint`,
+	// which the second pass takes as `known`, classifying the blocks known uniform at once.
 	virtual Bounds inflate_2(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space) const = 0;
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space, masking::hint* keep_hint) const = 0;
 	virtual Bounds deflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap) const = 0;
+		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap, masking::hint const* known) const = 0;
+	// derives the inflation of the source from the distance field of `fr` instead, if the algorithm allows.
+	virtual std::optional<Bounds> inflate_sdf(int sum_size_raw, int param_a,
+		i16* dst_buf, bool dst_colored, size_t dst_stride, frame const& fr) const { return std::nullopt; }
+	// how the draft mode scales down the source to inflate.
+	virtual Filter::Draft::pool draft_pool() const { return Filter::Draft::pool::max; }
 
 private:
 	struct sizing {
@@ -131,12 +136,12 @@ private:
 			allows_buffer_overlap;
 		bool invalid;
 	};
-	sizing measure(int size, int neg_size, int blur_px, int src_w, int src_h) const
+	sizing measure(int size, int neg_size, int blur_px, int src_w, int src_h, int yca_max_w, int yca_max_h) const
 	{
 		constexpr sizing invalid_size{ .invalid = true };
 		if (size <= 0 && neg_size <= 0) return invalid_size;
 
-		auto [mem_max_w, mem_max_h] = max_size();
+		auto [mem_max_w, mem_max_h] = max_size(yca_max_w, yca_max_h);
 		// to fit with the intermediate buffers.
 		while (true) {
 			blur_px = std::clamp(blur_px, 0, size);
@@ -155,7 +160,7 @@ private:
 				h +=2 * (-spec.neg_displace + blur_displace);
 
 				// check if it exceeds the limit.
-				diff = std::max(w - exedit.yca_max_w, h - exedit.yca_max_h);
+				diff = std::max(w - yca_max_w, h - yca_max_h);
 				if (diff <= 0) return {
 					.sum_size_raw = sum_size, .sum_displace = spec.sum_displace,
 					.neg_size_raw = neg_size, .neg_displace = spec.neg_displace,
@@ -180,34 +185,64 @@ private:
 	}
 
 public:
-	int measure_displace(int size, int neg_size, int blur_px, int src_w, int src_h) const
+	int measure_displace(int size, int neg_size, int blur_px, frame const& fr) const
 	{
-		auto sz = measure(size, neg_size, blur_px, src_w, src_h);
+		auto sz = measure(size, neg_size, blur_px, fr.obj_w, fr.obj_h, fr.max_w, fr.max_h);
 		return sz.sum_displace - sz.neg_displace + sz.blur_displace;
 	}
+	// the distance within which the source affects the result, or -1 if invalid.
+	// one more pixel for the rounded rims of the disks.
+	int measure_reach(int size, int neg_size, int blur_px, frame const& fr) const
+	{
+		auto sz = measure(size, neg_size, blur_px, fr.obj_w, fr.obj_h, fr.max_w, fr.max_h);
+		if (sz.invalid) return -1;
+		return sz.sum_displace + sz.neg_displace + sz.blur_displace + 1;
+	}
 
 	struct infl_result {
 		int displace;
 		bool is_empty; // entire image is found transparent.
 		bool invalid;
 	};
-	infl_result operator()(int size, int neg_size, int blur_px, int param_a, ExEdit::FilterProcInfo* efpip) const
+	// if `margins` is given, the alpha values out of the bounds stored there are left for the caller to clear.
+	infl_result operator()(int size, int neg_size, int blur_px, int param_a, frame& fr, Bounds* margins = nullptr) const
 	{
 		constexpr infl_result invalid{ .invalid = true };
 		// calculate sizing values.
-		int const src_w = efpip->obj_w, src_h = efpip->obj_h;
-		auto const sz = measure(size, neg_size, blur_px, src_w, src_h);
+		int const src_w = fr.obj_w, src_h = fr.obj_h;
+		auto const sz = measure(size, neg_size, blur_px, src_w, src_h, fr.max_w, fr.max_h);
 		if (sz.invalid) return invalid;
 
 		// manipulate the final size so chatterings wouldn't occur.
 		int const displace = (sz.sum_size_raw - sz.neg_size_raw + (sz.blur_size_raw >> 1) + (den_size >> 1)) / den_size,
 			diff_displace = displace - (sz.sum_displace - sz.neg_displace + sz.blur_displace),
-			diff_disp_cnt = diff_displace * (1 + efpip->obj_line);
+			diff_disp_cnt = diff_displace * (1 + fr.obj_line);
+		if (margins != nullptr) *margins = { 0, 0, src_w + 2 * displace, src_h + 2 * displace };
+
+		if (auto const pool = draft_pool(); Filter::Draft::applies(fr, pool, sz.sum_size_raw / den_size)) {
+			// compute on the scaled-down image, and scale the result up.
+			int const f = fr.draft;
+			frame small = Filter::Draft::reduce(fr, pool);
+			auto const result = (*this)((sz.sum_size_raw + (sz.blur_size_raw >> 1) - sz.neg_size_raw) / f,
+				sz.neg_size_raw / f, sz.blur_size_raw / f, param_a, small);
+			if (!result.invalid) {
+				if (result.is_empty) return {
+					.displace = displace,
+					.is_empty = true,
+				};
+				Filter::Draft::expand({
+						.buf = &small.obj_temp->a, .step = 4, .stride = 4 * static_cast<size_t>(small.obj_line),
+						.bd = { 0, 0, small.obj_w + 2 * result.displace, small.obj_h + 2 * result.displace },
+					}, -result.displace, f,
+					&fr.obj_temp->a, 4, 4 * fr.obj_line, src_w + 2 * displace, src_h + 2 * displace, -displace);
+				return { .displace = displace };
+			}
+		}
 
 		Bounds bd{ 0, 0, src_w, src_h };
 		if (!sz.do_infl && !sz.do_defl) {
-			zero_op(param_a, efpip->obj_edit, efpip->obj_line,
-				bd.wd(), bd.ht(), &efpip->obj_temp[diff_disp_cnt].a, true, 4 * efpip->obj_line);
+			zero_op(param_a, fr.obj_edit, fr.obj_line,
+				bd.wd(), bd.ht(), &fr.obj_temp[diff_disp_cnt].a, true, 4 * fr.obj_line);
 			bd = bd.move(diff_displace, diff_displace);
 		}
 		else {
@@ -216,37 +251,43 @@ public:
 				size_t med_stride = (bd.wd() + 2 * sz.sum_displace + 1) & (-2);
 				i16* med_buffer; void* heap;
 				if (sz.allows_buffer_overlap) {
-					med_buffer = reinterpret_cast<i16*>(efpip->obj_temp);
-					heap = *exedit.memory_ptr;
+					med_buffer = reinterpret_cast<i16*>(fr.obj_temp);
+					heap = fr.heap;
 				}
 				else {
-					med_buffer = reinterpret_cast<i16*>(*exedit.memory_ptr);
+					med_buffer = reinterpret_cast<i16*>(fr.heap);
 					heap = med_buffer + med_stride * (bd.ht() + 2 * sz.sum_displace);
 				}
 
 				// then process by two passes.
+				thread_local masking::hint hint{};
+				hint.clear();
 				if (sz.do_infl) {
-					bd = inflate_2(sz.sum_size_raw, param_a,
-						efpip->obj_edit, efpip->obj_line, bd.wd(), bd.ht(),
-						med_buffer, med_stride, heap, efpip->obj_temp);
+					if (auto const sdf_bd = inflate_sdf(sz.sum_size_raw, param_a,
+						med_buffer, false, med_stride, fr)) bd = *sdf_bd;
+					else bd = inflate_2(sz.sum_size_raw, param_a,
+						fr.obj_edit, fr.obj_line, bd.wd(), bd.ht(),
+						med_buffer, med_stride, heap, fr.obj_temp, &hint);
 					if (bd.is_empty()) return {
 						.displace = displace,
 						.is_empty = true,
 					};
 				}
-				else zero_op(param_a, efpip->obj_edit, efpip->obj_line, bd.wd(), bd.ht(),
+				else zero_op(param_a, fr.obj_edit, fr.obj_line, bd.wd(), bd.ht(),
 					med_buffer, false, med_stride);
 				bd = deflate_2(sz.neg_size_raw, param_a,
 					med_buffer + bd.L + bd.T * med_stride, med_stride, bd.wd(), bd.ht(),
-					&efpip->obj_temp[bd.L + bd.T * efpip->obj_line + diff_disp_cnt], efpip->obj_line, heap)
+					&fr.obj_temp[bd.L + bd.T * fr.obj_line + diff_disp_cnt], fr.obj_line, heap, &hint)
 					.move(bd.L + diff_displace, bd.T + diff_displace);
 			}
 			else {
 				// process by one pass.
-				bd = inflate_1(sz.sum_size_raw, param_a,
-					efpip->obj_edit, efpip->obj_line, bd.wd(), bd.ht(),
-					&efpip->obj_temp[diff_disp_cnt], *exedit.memory_ptr)
-					.move(diff_displace, diff_displace);
+				if (auto const sdf_bd = inflate_sdf(sz.sum_size_raw, param_a,
+					&fr.obj_temp[diff_disp_cnt].a, true, 4 * fr.obj_line, fr)) bd = *sdf_bd;
+				else bd = inflate_1(sz.sum_size_raw, param_a,
+					fr.obj_edit, fr.obj_line, bd.wd(), bd.ht(),
+					&fr.obj_temp[diff_disp_cnt], fr.heap);
+				bd = bd.move(diff_displace, diff_displace);
 			}
 			if (bd.is_empty()) return {
 				.displace = displace,
@@ -255,9 +296,9 @@ public:
 
 			// apply blur.
 			if (sz.blur_size_raw > 0) {
-				buff::blur_alpha(efpip->obj_temp, efpip->obj_line,
+				buff::blur_alpha(fr.obj_temp, fr.obj_line,
 					bd.L, bd.T, bd.wd(), bd.ht(), (sz.blur_size_raw * buff::den_blur_px) / den_size,
-					*exedit.memory_ptr);
+					fr.heap);
 
 				bd = bd.inflate_br(2 * sz.blur_displace);
 			}
@@ -265,7 +306,8 @@ public:
 
 		// clear the four sides of margins if present.
 		int dst_w = src_w + 2 * displace, dst_h = src_h + 2 * displace;
-		buff::clear_alpha_chrome(efpip->obj_temp, efpip->obj_line,
+		if (margins != nullptr) *margins = bd;
+		else buff::clear_alpha_chrome(fr.obj_temp, fr.obj_line,
 			{ 0, 0, dst_w, dst_h }, bd);
 
 		return { .displace = displace };
@@ -278,6 +320,8 @@ protected:
 	static constexpr i16 to_thresh(int param_a) {
 		return (max_alpha - 1) * param_a / max_param_a;
 	}
+	// these run fast enough for any radius, faster than scaling up the result.
+	Filter::Draft::pool draft_pool() const override { return Filter::Draft::pool::none; }
 	void zero_op(int param_a, ExEdit::PixelYCA const* src_buf, size_t src_stride,
 		int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride) const override
 	{
@@ -288,7 +332,7 @@ protected:
 			dst_buf, dst_stride, 0, 0, to_thresh(param_a));
 	}
 	Bounds inflate_2(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space) const override
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space, masking::hint* keep_hint) const override
 	{
 		return bin::inflate(src_w, src_h,
 			&src_buf->a, true, 4 * src_stride, to_thresh(param_a),
@@ -298,13 +342,15 @@ protected:
 };
 
 // algorithm "bin".
-constexpr struct : infl_bin_base {
+constexpr struct infl_bin : infl_bin_base {
 private:
-	static inline constinit int mem_max_w = 0, mem_max_h = 0;
-	static void init_mem_max()
+	// cached for each thread, as frames of different sizes may run in parallel.
+	static inline thread_local constinit int mem_max_w = 0, mem_max_h = 0, yca_w = 0, yca_h = 0;
+	static void init_mem_max(int yca_max_w, int yca_max_h)
 	{
-		size_t const mem_max = obj_mem_max();
-		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / sizeof(i32));
+		yca_w = yca_max_w; yca_h = yca_max_h;
+		size_t const mem_max = frame::heap_size(yca_max_w, yca_max_h);
+		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / sizeof(i32), yca_max_w, yca_max_h);
 
 		// trim by 4 dots until it fits within available space.
 		while (sizeof(i16) * ((mem_max_w + 1) & (-2)) * mem_max_h > mem_max ||
@@ -313,9 +359,9 @@ private:
 	}
 
 protected:
-	std::pair<int, int> max_size() const override
+	std::pair<int, int> max_size(int yca_max_w, int yca_max_h) const override
 	{
-		if (mem_max_w == 0) init_mem_max();
+		if (yca_w != yca_max_w || yca_h != yca_max_h) init_mem_max(yca_max_w, yca_max_h);
 		return { mem_max_w, mem_max_h };
 	}
 	process_spec tell_spec(int sum_size, int neg_size) const override
@@ -339,23 +385,32 @@ protected:
 			heap, (sum_size_raw * sum_size_raw) / (den_size * den_size));
 	}
 	Bounds deflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap) const override
+		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap, masking::hint const* known) const override
 	{
 		return bin::deflate(src_w, src_h,
 			src_buf, false, src_stride, to_thresh(param_a),
 			&dst_buf->a, true, 4 * dst_stride,
 			heap, (neg_size_raw * neg_size_raw) / (den_size * den_size));
 	}
+	std::optional<Bounds> inflate_sdf(int sum_size_raw, int param_a,
+		i16* dst_buf, bool dst_colored, size_t dst_stride, frame const& fr) const override
+	{
+		auto* const field = Filter::Sdf::of(fr, to_thresh(param_a));
+		if (field == nullptr) return std::nullopt;
+		return Filter::Sdf::inflate(*field, (sum_size_raw * sum_size_raw) / (den_size * den_size),
+			dst_buf, dst_colored, dst_stride);
+	}
 } infl_bin{};
 
 // algorithm "bin2x".
-constexpr struct : infl_bin_base {
+constexpr struct infl_bin2x : infl_bin_base {
 private:
-	static inline constinit int mem_max_w = 0, mem_max_h = 0;
-	static void init_mem_max()
+	static inline thread_local constinit int mem_max_w = 0, mem_max_h = 0, yca_w = 0, yca_h = 0;
+	static void init_mem_max(int yca_max_w, int yca_max_h)
 	{
-		size_t const mem_max = obj_mem_max();
-		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / sizeof(i32));
+		yca_w = yca_max_w; yca_h = yca_max_h;
+		size_t const mem_max = frame::heap_size(yca_max_w, yca_max_h);
+		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / sizeof(i32), yca_max_w, yca_max_h);
 
 		// trim by 4 dots until it fits within available space.
 		while (sizeof(i16) * ((mem_max_w + 1) & (-2)) * mem_max_h > mem_max ||
@@ -364,9 +419,9 @@ private:
 	}
 
 protected:
-	std::pair<int, int> max_size() const override
+	std::pair<int, int> max_size(int yca_max_w, int yca_max_h) const override
 	{
-		if (mem_max_w == 0) init_mem_max();
+		if (yca_w != yca_max_w || yca_h != yca_max_h) init_mem_max(yca_max_w, yca_max_h);
 		return { mem_max_w, mem_max_h };
 	}
 	process_spec tell_spec(int sum_size, int neg_size) const override
@@ -391,7 +446,7 @@ protected:
 			heap, (4 * sum_size_raw * sum_size_raw) / (den_size * den_size));
 	}
 	Bounds deflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap) const override
+		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap, masking::hint const* known) const override
 	{
 		return bin2x::deflate(src_w, src_h,
 			src_buf, false, src_stride, to_thresh(param_a),
@@ -401,13 +456,15 @@ protected:
 } infl_bin2x{};
 
 // algorithm "max".
-constexpr struct : infl_base {
+template<class P>
+struct infl_max : infl_base {
 private:
-	static inline constinit int mem_max_w = 0, mem_max_h = 0;
-	static void init_mem_max()
+	static inline thread_local constinit int mem_max_w = 0, mem_max_h = 0, yca_w = 0, yca_h = 0;
+	static void init_mem_max(int yca_max_w, int yca_max_h)
 	{
-		size_t const mem_max = obj_mem_max();
-		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / (sizeof(i16) + sizeof(uint8_t)));
+		yca_w = yca_max_w; yca_h = yca_max_h;
+		size_t const mem_max = frame::heap_size(yca_max_w, yca_max_h);
+		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / (sizeof(i16) + sizeof(uint8_t)), yca_max_w, yca_max_h);
 
 		// trim by 4 dots until it fits within available space.
 		while (sizeof(i16) * ((mem_max_w + 1) & (-2)) * mem_max_h
@@ -416,9 +473,9 @@ private:
 	}
 
 protected:
-	std::pair<int, int> max_size() const override
+	std::pair<int, int> max_size(int yca_max_w, int yca_max_h) const override
 	{
-		if (mem_max_w == 0) init_mem_max();
+		if (yca_w != yca_max_w || yca_h != yca_max_h) init_mem_max(yca_max_w, yca_max_h);
 		return { mem_max_w, mem_max_h };
 	}
 	process_spec tell_spec(int sum_size, int neg_size) const override
@@ -436,35 +493,37 @@ protected:
 	Bounds inflate_1(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t stride,
 		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, void* heap) const override
 	{
-		return max::inflate(src_w, src_h, src_buf, stride,
+		return max::inflate<P>(src_w, src_h, src_buf, stride,
 			&dst_buf->a, true, 4 * stride,
 			reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(heap) + max::alpha_space_size(src_w, src_h)),
 			(sum_size_raw * sum_size_raw) / (den_size * den_size), heap);
 	}
 	Bounds inflate_2(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space) const override
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space, masking::hint* keep_hint) const override
 	{
-		return max::inflate(src_w, src_h, src_buf, src_stride,
+		return max::inflate<P>(src_w, src_h, src_buf, src_stride,
 			dst_buf, false, dst_stride,
-			heap, (sum_size_raw * sum_size_raw) / (den_size * den_size), alpha_space);
+			heap, (sum_size_raw * sum_size_raw) / (den_size * den_size), alpha_space, keep_hint);
 	}
 	Bounds deflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap) const override
+		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap, masking::hint const* known) const override
 	{
 		return max::deflate(src_w, src_h, src_buf, src_stride,
 			&dst_buf->a, true, 4 * dst_stride,
-			heap, (neg_size_raw * neg_size_raw) / (den_size * den_size));
+			heap, (neg_size_raw * neg_size_raw) / (den_size * den_size), known);
 	}
-} infl_max;
+};
 
 // algorithm "max_fast".
-constexpr struct : infl_base {
+template<class P>
+struct infl_max_fast : infl_base {
 private:
-	static inline constinit int mem_max_w = 0, mem_max_h = 0;
-	static void init_mem_max()
+	static inline thread_local constinit int mem_max_w = 0, mem_max_h = 0, yca_w = 0, yca_h = 0;
+	static void init_mem_max(int yca_max_w, int yca_max_h)
 	{
-		size_t const mem_max = obj_mem_max();
-		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / (sizeof(i16) + sizeof(uint8_t)));
+		yca_w = yca_max_w; yca_h = yca_max_h;
+		size_t const mem_max = frame::heap_size(yca_max_w, yca_max_h);
+		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / (sizeof(i16) + sizeof(uint8_t)), yca_max_w, yca_max_h);
 
 		// trim by 4 dots until it fits within available space.
 		while (sizeof(i16) * ((mem_max_w + 1) & (-2)) * mem_max_h
@@ -473,9 +532,9 @@ private:
 	}
 
 protected:
-	std::pair<int, int> max_size() const override
+	std::pair<int, int> max_size(int yca_max_w, int yca_max_h) const override
 	{
-		if (mem_max_w == 0) init_mem_max();
+		if (yca_w != yca_max_w || yca_h != yca_max_h) init_mem_max(yca_max_w, yca_max_h);
 		return { mem_max_w, mem_max_h };
 	}
 	process_spec tell_spec(int sum_size, int neg_size) const override
@@ -493,35 +552,37 @@ protected:
 	Bounds inflate_1(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t stride,
 		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, void* heap) const override
 	{
-		return max_fast::inflate(src_w, src_h, src_buf, stride,
+		return max_fast::inflate<P>(src_w, src_h, src_buf, stride,
 			&dst_buf->a, true, 4 * stride,
 			reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(heap) + max_fast::alpha_space_size(src_w, src_h)),
 			(sum_size_raw * sum_size_raw) / (den_size * den_size), heap);
 	}
 	Bounds inflate_2(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space) const override
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space, masking::hint* keep_hint) const override
 	{
-		return max_fast::inflate(src_w, src_h, src_buf, src_stride,
+		return max_fast::inflate<P>(src_w, src_h, src_buf, src_stride,
 			dst_buf, false, dst_stride,
-			heap, (sum_size_raw * sum_size_raw) / (den_size * den_size), alpha_space);
+			heap, (sum_size_raw * sum_size_raw) / (den_size * den_size), alpha_space, keep_hint);
 	}
 	Bounds deflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap) const override
+		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap, masking::hint const* known) const override
 	{
 		return max_fast::deflate(src_w, src_h, src_buf, src_stride,
 			&dst_buf->a, true, 4 * dst_stride,
-			heap, (neg_size_raw * neg_size_raw) / (den_size * den_size));
+			heap, (neg_size_raw * neg_size_raw) / (den_size * den_size), known);
 	}
-} infl_max_fast;
+};
 
 // algorithm "sum".
-constexpr struct : infl_base {
+template<class P>
+struct infl_sum : infl_base {
 private:
-	static inline constinit int mem_max_w = 0, mem_max_h = 0;
-	static void init_mem_max()
+	static inline thread_local constinit int mem_max_w = 0, mem_max_h = 0, yca_w = 0, yca_h = 0;
+	static void init_mem_max(int yca_max_w, int yca_max_h)
 	{
-		size_t const mem_max = obj_mem_max();
-		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / (sizeof(i16) + sizeof(uint8_t)));
+		yca_w = yca_max_w; yca_h = yca_max_h;
+		size_t const mem_max = frame::heap_size(yca_max_w, yca_max_h);
+		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / (sizeof(i16) + sizeof(uint8_t)), yca_max_w, yca_max_h);
 
 		// trim by 4 dots until it fits within available space.
 		while (sizeof(i16) * ((mem_max_w + 1) & (-2)) * mem_max_h
@@ -530,9 +591,9 @@ private:
 	}
 
 protected:
-	std::pair<int, int> max_size() const override
+	std::pair<int, int> max_size(int yca_max_w, int yca_max_h) const override
 	{
-		if (mem_max_w == 0) init_mem_max();
+		if (yca_w != yca_max_w || yca_h != yca_max_h) init_mem_max(yca_max_w, yca_max_h);
 		return { mem_max_w, mem_max_h };
 	}
 	process_spec tell_spec(int sum_size, int neg_size) const override
@@ -547,119 +608,139 @@ protected:
 			.allows_buffer_overlap = false,
 		};
 	}
+	Filter::Draft::pool draft_pool() const override { return Filter::Draft::pool::mean; }
 	Bounds inflate_1(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t stride,
 		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, void* heap) const override
 	{
-		return sum::inflate(src_w, src_h, src_buf, stride,
+		return sum::inflate<P>(src_w, src_h, src_buf, stride,
 			&dst_buf->a, true, 4 * stride, (param_a * sum::den_cap_rate) / max_param_a,
 			reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(heap) + sum::alpha_space_size(src_w, src_h)),
 			(sum_size_raw * sum_size_raw) / (den_size * den_size), heap);
 	}
 	Bounds inflate_2(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space) const override
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space, masking::hint* keep_hint) const override
 	{
-		return sum::inflate(src_w, src_h, src_buf, src_stride,
+		return sum::inflate<P>(src_w, src_h, src_buf, src_stride,
 			dst_buf + (1 + dst_stride), false, dst_stride, (param_a * sum::den_cap_rate) / max_param_a,
-			heap, (sum_size_raw * sum_size_raw) / (den_size * den_size), alpha_space)
+			heap, (sum_size_raw * sum_size_raw) / (den_size * den_size), alpha_space, keep_hint)
 			.inflate_br(2);
 	}
 	Bounds deflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap) const override
+		int src_w, int src_h, ExEdit::PixelYCA* dst_buf, size_t dst_stride, void* heap, masking::hint const* known) const override
 	{
 		return sum::deflate(src_w - 2, src_h - 2, src_buf + (1 + src_stride), src_stride,
 			&dst_buf->a, true, 4 * dst_stride, (param_a * sum::den_cap_rate) / max_param_a,
-			heap, (neg_size_raw * neg_size_raw) / (den_size * den_size));
+			heap, (neg_size_raw * neg_size_raw) / (den_size * den_size), known);
 	}
-} infl_sum;
+};
 
-static constexpr infl_base const& choose_infl(Filter::Algorithm algorithm) {
+constexpr infl_max<alpha12> infl_max_12{};
+constexpr infl_max<alpha8> infl_max_8{};
+constexpr infl_max_fast<alpha12> infl_max_fast_12{};
+constexpr infl_max_fast<alpha8> infl_max_fast_8{};
+constexpr infl_sum<alpha12> infl_sum_12{};
+constexpr infl_sum<alpha8> infl_sum_8{};
+
+// `use_alpha8` has no effect on "bin" and "bin2x", which see only whether pixels are opaque.
+static constexpr infl_base const& choose_infl(Filter::Algorithm algorithm, bool use_alpha8) {
 	switch (algorithm) {
 		using algo = Filter::Algorithm;
 	case algo::bin: return infl_bin;
 	default:
 	case algo::bin2x: return infl_bin2x;
-	case algo::max: return infl_max;
-	case algo::max_fast: return infl_max_fast;
-	case algo::sum: return infl_sum;
+	case algo::max: if (use_alpha8) return infl_max_8; return infl_max_12;
+	case algo::max_fast: if (use_alpha8) return infl_max_fast_8; return infl_max_fast_12;
+	case algo::sum: if (use_alpha8) return infl_sum_8; return infl_sum_12;
 	}
 }
 
 constexpr Filter::Common::defl_bin<den_size, max_param_a> defl_bin{};
 constexpr Filter::Common::defl_bin2x<den_size, max_param_a> defl_bin2x{};
-constexpr Filter::Common::defl_max<den_size> defl_max{};
-constexpr Filter::Common::defl_max_fast<den_size> defl_max_fast{};
-constexpr Filter::Common::defl_sum<den_size, max_param_a> defl_sum{};
-
-static constexpr defl_base const& choose_defl(Filter::Algorithm algorithm) {
+constexpr Filter::Common::defl_max<den_size> defl_max_12{};
+constexpr Filter::Common::defl_max<den_size, alpha8> defl_max_8{};
+constexpr Filter::Common::defl_max_fast<den_size> defl_max_fast_12{};
+constexpr Filter::Common::defl_max_fast<den_size, alpha8> defl_max_fast_8{};
+constexpr Filter::Common::defl_sum<den_size, max_param_a> defl_sum_12{};
+constexpr Filter::Common::defl_sum<den_size, max_param_a, alpha8> defl_sum_8{};
+
+static constexpr defl_base const& choose_defl(Filter::Algorithm algorithm, bool use_alpha8) {
 	switch (algorithm) {
 		using algo = Filter::Algorithm;
 	case algo::bin: return defl_bin;
 	default:
 	case algo::bin2x: return defl_bin2x;
-	case algo::max: return defl_max;
-	case algo::max_fast: return defl_max_fast;
-	case algo::sum: return defl_sum;
+	case algo::max: if (use_alpha8) return defl_max_8; return defl_max_12;
+	case algo::max_fast: if (use_alpha8) return defl_max_fast_8; return defl_max_fast_12;
+	case algo::sum: if (use_alpha8) return defl_sum_8; return defl_sum_12;
 	}
 }
 
 // assumes displace >= 0.
-static inline void expand_foursides(int displace, int f_alpha, ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
+// `obj_edit` has room for the expanded image as well as `obj_temp`, so the image is shifted in place.
+static inline void expand_foursides(int displace, int f_alpha, frame& fr)
 {
 	if (displace <= 0 && f_alpha >= max_alpha) return;
 
-	if (displace > 0 || f_alpha <= 0)
-		buff::clear_alpha(efpip->obj_temp, efpip->obj_line,
-			0, 0, efpip->obj_w + 2 * displace, efpip->obj_h + 2 * displace);
-
-	if (f_alpha >= max_alpha) {
-		multi_thread(efpip->obj_h, [&](int thread_id, int thread_num) {
-			int const y0 = efpip->obj_h * thread_id / thread_num, y1 = efpip->obj_h * (thread_id + 1) / thread_num;
-			auto s_buf_y = efpip->obj_edit + y0 * efpip->obj_line,
-				d_buf_y = efpip->obj_temp + displace + (displace + y0) * efpip->obj_line;
-			for (int y = y1 - y0; --y >= 0; s_buf_y += efpip->obj_line, d_buf_y += efpip->obj_line)
-				std::memcpy(d_buf_y, s_buf_y, sizeof(*d_buf_y) * efpip->obj_w);
-		});
+	int const src_w = fr.obj_w, src_h = fr.obj_h;
+	fr.obj_w += 2 * displace; fr.obj_h += 2 * displace;
+	if (f_alpha <= 0) {
+		// nothing remains visible.
+		buff::clear_alpha(fr.obj_edit, fr.obj_line, 0, 0, fr.obj_w, fr.obj_h);
+		return;
 	}
-	else if (f_alpha > 0) {
-		multi_thread(efpip->obj_h, [&](int thread_id, int thread_num) {
-			int const y0 = efpip->obj_h * thread_id / thread_num, y1 = efpip->obj_h * (thread_id + 1) / thread_num;
-			auto s_buf_y = efpip->obj_edit + y0 * efpip->obj_line,
-				d_buf_y = efpip->obj_temp + displace + (displace + y0) * efpip->obj_line;
-			for (int y = y1 - y0; --y >= 0; s_buf_y += efpip->obj_line, d_buf_y += efpip->obj_line) {
-				auto s_buf_x = s_buf_y, d_buf_x = d_buf_y;
-				for (int x = efpip->obj_w; --x >= 0; s_buf_x++, d_buf_x++)
-					*d_buf_x = {
-						.y  = s_buf_x->y ,
-						.cb = s_buf_x->cb,
-						.cr = s_buf_x->cr,
-						.a  = static_cast<i16>((f_alpha * s_buf_x->a) >> log2_max_alpha),
-					};
+
+	auto const scale = [f_alpha](ExEdit::PixelYCA const& px) noexcept -> ExEdit::PixelYCA {
+		return {
+			.y  = px.y ,
+			.cb = px.cb,
+			.cr = px.cr,
+			.a  = static_cast<i16>((f_alpha * px.a) >> log2_max_alpha),
+		};
+	};
+	if (displace > 0) {
+		// each row moves to a row below, which has already moved away, so go from the bottom.
+		// the rows may not be split among threads, as a row would be overwritten before it's read.
+		for (int y = src_h; --y >= 0;) {
+			auto const s_buf_y = fr.obj_edit + y * fr.obj_line,
+				d_buf_y = s_buf_y + displace * (1 + fr.obj_line);
+			if (f_alpha >= max_alpha) std::memcpy(d_buf_y, s_buf_y, sizeof(*d_buf_y) * src_w);
+			else for (int x = 0; x < src_w; x++) d_buf_y[x] = scale(s_buf_y[x]);
+		}
+
+		// clear the new margins only.
+		buff::clear_alpha_chrome(fr.obj_edit, fr.obj_line, { 0, 0, fr.obj_w, fr.obj_h },
+			{ displace, displace, displace + src_w, displace + src_h });
+	}
+	else {
+		multi_thread(src_h, [&](int thread_id, int thread_num) {
+			int const y0 = src_h * thread_id / thread_num, y1 = src_h * (thread_id + 1) / thread_num;
+			auto buf_y = fr.obj_edit + y0 * fr.obj_line;
+			for (int y = y1 - y0; --y >= 0; buf_y += fr.obj_line) {
+				auto buf_x = buf_y;
+				for (int x = src_w; --x >= 0; buf_x++) *buf_x = scale(*buf_x);
 			}
 		});
 	}
-	efpip->obj_w += 2 * displace; efpip->obj_h += 2 * displace;
-	std::swap(efpip->obj_temp, efpip->obj_edit);
 }
 
 
 ////////////////////////////////
 // フィルタ処理のエントリポイント．
 ////////////////////////////////
-BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
+bool Filter::Border::process(params const& p, frame& fr)
 {
-	int const src_w = efpip->obj_w, src_h = efpip->obj_h;
-	if (src_w <= 0 || src_h <= 0) return TRUE;
+	int const src_w = fr.obj_w, src_h = fr.obj_h;
+	if (src_w <= 0 || src_h <= 0) return true;
 
 	int const
-		size		= std::clamp(efp->track[idx_track::size		], min_size		, max_size		),
-		neg_size	= std::clamp(efp->track[idx_track::neg_size	], min_neg_size	, max_neg_size	),
-		transp		= std::clamp(efp->track[idx_track::transp	], min_transp	, max_transp	),
-		f_transp	= std::clamp(efp->track[idx_track::f_transp	], min_f_transp	, max_f_transp	),
-		blur		= std::clamp(efp->track[idx_track::blur		], min_blur		, max_blur		),
-		param_a		= std::clamp(efp->track[idx_track::param_a	], min_param_a	, max_param_a	),
-		img_x		= std::clamp(efp->track[idx_track::img_x	], min_img_x	, max_img_x		),
-		img_y		= std::clamp(efp->track[idx_track::img_y	], min_img_y	, max_img_y		);
-	auto* const exdata = reinterpret_cast<Exdata*>(efp->exdata_ptr);
+		size		= std::clamp(p.size		, min_size		, max_size		),
+		neg_size	= std::clamp(p.neg_size	, min_neg_size	, max_neg_size	),
+		transp		= std::clamp(p.transp	, min_transp	, max_transp	),
+		f_transp	= std::clamp(p.f_transp	, min_f_transp	, max_f_transp	),
+		blur		= std::clamp(p.blur		, min_blur		, max_blur		),
+		param_a		= std::clamp(p.param_a	, min_param_a	, max_param_a	),
+		img_x		= std::clamp(p.img_x	, min_img_x	, max_img_x		),
+		img_y		= std::clamp(p.img_y	, min_img_y	, max_img_y		);
 
 	int const
 		alpha = std::clamp<int>(max_alpha * (max_transp - transp) / max_transp, 0, max_alpha),
@@ -667,37 +748,59 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 		blur_px = blur == 0 || arith::abs(size) <= den_size ? 0 :
 			(std::max(arith::abs(size) - den_size - 1, 0) * (blur - 1)) / (max_blur - 1) + 1;
 
+	int const ext = std::max(size, 0) / den_size;
+	MultiThread::serial_scope const serial{ multi_thread,
+		(src_w + 2 * ext) * (src_h + 2 * ext) < Filter::small_obj_area };
+
 	// "fake" size by 0.4 so integral-sized shape will more likely look smooth.
 	int const lifted_size = size + (size >= 0 ? +1 : -1) * ((den_size >> 1) - 1);
 
 	// handle trivial cases.
 	if (size == 0 || alpha <= 0) {
-		expand_foursides(size <= 0 ? 0 : choose_infl(exdata->algorithm)
-			.measure_displace(lifted_size, neg_size, blur_px, src_w, src_h),
-			f_alpha, efp, efpip);
-		return TRUE;
+		expand_foursides(size <= 0 ? 0 : choose_infl(p.algorithm, fr.alpha8)
+			.measure_displace(lifted_size, neg_size, blur_px, fr),
+			f_alpha, fr);
+		return true;
 	}
 
 	// general cases.
+	// unless the result is kept for later, the margins of its plane are cleared as each row is composited.
+	bool const lazy = !Filter::Incremental::keeps(fr);
+	Bounds margins{};
 	if (lifted_size > 0) {
-		auto result = choose_infl(exdata->algorithm)(lifted_size, neg_size, blur_px, param_a, efpip);
-		if (result.invalid) return TRUE;
+		auto const& infl = choose_infl(p.algorithm, fr.alpha8);
+		auto result = Filter::Incremental::through('B',
+			{ static_cast<int32_t>(p.algorithm), lifted_size, neg_size, blur_px, param_a, fr.alpha8, fr.draft },
+			[&](frame const& f) { return infl.measure_reach(lifted_size, neg_size, blur_px, f); }, fr,
+			[&](frame& f) { return infl(lifted_size, neg_size, blur_px, param_a, f, lazy ? &margins : nullptr); },
+			[&](auto const& r, frame const& f) -> Filter::Cache::plane {
+				if (r.invalid || r.is_empty) return {};
+				return {
+					.buf = &f.obj_temp->a, .step = 4, .stride = 4 * static_cast<size_t>(f.obj_line),
+					.bd = { 0, 0, f.obj_w + 2 * r.displace, f.obj_h + 2 * r.displace },
+				};
+			});
+		if (result.invalid) return true;
 
 		if (result.is_empty) {
 			// the inflated background is entirely transparent.
-			expand_foursides(result.displace, f_alpha, efp, efpip);
-			return TRUE;
+			expand_foursides(result.displace, f_alpha, fr);
+			return true;
 		}
 
 		int const
-			dst_w = efpip->obj_w += 2 * result.displace,
-			dst_h = efpip->obj_h += 2 * result.displace;
-		std::swap(efpip->obj_temp, efpip->obj_edit);
+			dst_w = fr.obj_w += 2 * result.displace,
+			dst_h = fr.obj_h += 2 * result.displace;
+		std::swap(fr.obj_temp, fr.obj_edit);
+
+		// with the original drawn fully opaque, the border is entirely hidden
+		// wherever the original pixel is fully opaque, so the pixel is simply copied.
+		bool const occludes = f_alpha >= max_alpha;
 
-		if (tiled_image const img{ exdata->file, img_x, img_y, result.displace, efp, *exedit.memory_ptr }) {
+		if (tiled_image const img{ p.pattern, img_x, img_y, result.displace, fr.heap, fr.obj_line, fr.max_h }) {
 			// image seems to have been successfully loaded.
 			// fill with the pattern image.
-			auto blend = [&, img_stride = efpip->obj_line](ExEdit::PixelYCA const& infl, ExEdit::PixelYCA const& orig, int px_x, int px_y) noexcept -> ExEdit::PixelYCA {
+			auto blend = [&, img_stride = fr.obj_line](ExEdit::PixelYCA const& infl, ExEdit::PixelYCA const& orig, int px_x, int px_y) noexcept -> ExEdit::PixelYCA {
 				auto& col = img[px_x + px_y * img_stride];
 				int a = (alpha * (((infl.a - orig.a) * col.a) >> log2_max_alpha)) >> log2_max_alpha;
 				int A = static_cast<uint32_t>(f_alpha * orig.a) >> log2_max_alpha; // making sure A >= 0.
@@ -712,7 +815,7 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 					.a = static_cast<i16>(A),
 				};
 			};
-			auto paint = [&, img_stride = efpip->obj_line](ExEdit::PixelYCA const& infl, int px_x, int px_y) noexcept -> ExEdit::PixelYCA {
+			auto paint = [&, img_stride = fr.obj_line](ExEdit::PixelYCA const& infl, int px_x, int px_y) noexcept -> ExEdit::PixelYCA {
 				auto& col = img[px_x + px_y * img_stride];
 				return {
 					.y = col.y, .cb = col.cb, .cr = col.cr,
@@ -720,19 +823,28 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 				};
 			};
 
+			MultiThread::chunks rows{ multi_thread, dst_h };
 			multi_thread(dst_h, [&](int thread_id, int thread_num) {
-				for (int y = thread_id; y < dst_h; y += thread_num) {
+				for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 					int i_x = img.ox, i_y = (y + img.oy) % img.h;
 					auto incr_x = [&] { i_x++; if (i_x >= img.w) i_x -= img.w; };
 
-					auto* dst = efpip->obj_edit + y * efpip->obj_line;
+					auto* dst = fr.obj_edit + y * fr.obj_line;
+					if (lazy) buff::clear_alpha_margin(dst, dst_w, y, margins);
 					if (y < result.displace || y >= dst_h - result.displace) {
 						for (int x = dst_w; --x >= 0; dst++, incr_x()) *dst = paint(*dst, i_x, i_y);
 					}
 					else {
-						auto* src = efpip->obj_temp + (y - result.displace) * efpip->obj_line;
+						auto* src = fr.obj_temp + (y - result.displace) * fr.obj_line;
 						for (int x = result.displace; --x >= 0; dst++, incr_x()) *dst = paint(*dst, i_x, i_y);
-						for (int x = dst_w - 2 * result.displace; --x >= 0; src++, dst++, incr_x()) *dst = blend(*dst, *src, i_x, i_y);
+						if (occludes) {
+							for (int x = dst_w - 2 * result.displace; --x >= 0; src++, dst++, incr_x())
+								*dst = src->a >= max_alpha ? *src : blend(*dst, *src, i_x, i_y);
+						}
+						else {
+							for (int x = dst_w - 2 * result.displace; --x >= 0; src++, dst++, incr_x())
+								*dst = blend(*dst, *src, i_x, i_y);
+						}
 						for (int x = result.displace; --x >= 0; dst++, incr_x()) *dst = paint(*dst, i_x, i_y);
 					}
 				}
@@ -740,7 +852,7 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 		}
 		else {
 			// fill with specified color.
-			auto const col = buff::fromRGB(exdata->color.r, exdata->color.g, exdata->color.b);
+			auto const col = buff::fromRGB(p.color.r, p.color.g, p.color.b);
 			auto blend = [&](ExEdit::PixelYCA const& infl, ExEdit::PixelYCA const& orig) noexcept -> ExEdit::PixelYCA {
 				int a = (alpha * (infl.a - orig.a)) >> log2_max_alpha;
 				int A = static_cast<uint32_t>(f_alpha * orig.a) >> log2_max_alpha; // making sure A >= 0.
@@ -762,16 +874,25 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 				};
 			};
 
+			MultiThread::chunks rows{ multi_thread, dst_h };
 			multi_thread(dst_h, [&](int thread_id, int thread_num) {
-				for (int y = thread_id; y < dst_h; y+= thread_num) {
-					auto* dst = efpip->obj_edit + y * efpip->obj_line;
+				for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+					auto* dst = fr.obj_edit + y * fr.obj_line;
+					if (lazy) buff::clear_alpha_margin(dst, dst_w, y, margins);
 					if (y < result.displace || y >= dst_h - result.displace) {
 						for (int x = dst_w; --x >= 0; dst++) *dst = paint(*dst);
 					}
 					else {
-						auto* src = efpip->obj_temp + (y - result.displace) * efpip->obj_line;
+						auto* src = fr.obj_temp + (y - result.displace) * fr.obj_line;
 						for (int x = result.displace; --x >= 0; dst++) *dst = paint(*dst);
-						for (int x = dst_w - 2 * result.displace; --x >= 0; src++, dst++) *dst = blend(*dst, *src);
+						if (occludes) {
+							for (int x = dst_w - 2 * result.displace; --x >= 0; src++, dst++)
+								*dst = src->a >= max_alpha ? *src : blend(*dst, *src);
+						}
+						else {
+							for (int x = dst_w - 2 * result.displace; --x >= 0; src++, dst++)
+								*dst = blend(*dst, *src);
+						}
 						for (int x = result.displace; --x >= 0; dst++) *dst = paint(*dst);
 					}
 				}
@@ -779,14 +900,19 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 		}
 	}
 	else {
-		auto result = choose_defl(exdata->algorithm)(
-			-lifted_size, neg_size, blur_px, param_a, false, false, efpip);
-		if (result.invalid) return TRUE;
-
-		if (tiled_image const img{ exdata->file, img_x, img_y, 0, efp, *exedit.memory_ptr }) {
+		auto const& defl = choose_defl(p.algorithm, fr.alpha8);
+		auto result = Filter::Incremental::through('b',
+			{ static_cast<int32_t>(p.algorithm), -lifted_size, neg_size, blur_px, param_a, fr.alpha8, fr.draft },
+			[&](frame const&) { return defl.measure_reach(-lifted_size, neg_size, blur_px); }, fr,
+			[&](frame& f) { return defl(-lifted_size, neg_size, blur_px, param_a, false, false, f,
+				nullptr, lazy ? &margins : nullptr); },
+			[](auto const& r, frame const& f) { return r.plane(f); });
+		if (result.invalid) return true;
+
+		if (tiled_image const img{ p.pattern, img_x, img_y, 0, fr.heap, fr.obj_line, fr.max_h }) {
 			// image seems to have been successfully loaded.
 			// fill with the pattern image.
-			auto blend = [&, img_stride = efpip->obj_line](i16 defl, ExEdit::PixelYCA const& orig, int px_x, int px_y) noexcept -> ExEdit::PixelYCA {
+			auto blend = [&, img_stride = fr.obj_line](i16 defl, ExEdit::PixelYCA const& orig, int px_x, int px_y) noexcept -> ExEdit::PixelYCA {
 				auto& col = img[px_x + px_y * img_stride];
 				int a = (alpha * (((max_alpha - defl) * col.a) >> log2_max_alpha)) >> log2_max_alpha,
 					A = static_cast<uint32_t>(orig.a * (max_alpha - a)) >> log2_max_alpha; // making sure A >= 0.
@@ -813,8 +939,8 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 					int const y0 = src_h * thread_id / thread_num, y1 = src_h * (thread_id + 1) / thread_num;
 					int i_y = (y0 + img.oy) % img.h;
 					auto incr_y = [&] { i_y++; if (i_y >= img.h) i_y -= img.h; };
-					auto* dst_y = efpip->obj_edit + y0 * efpip->obj_line;
-					for (int y = y1 - y0; --y >= 0; dst_y += efpip->obj_line, incr_y()) {
+					auto* dst_y = fr.obj_edit + y0 * fr.obj_line;
+					for (int y = y1 - y0; --y >= 0; dst_y += fr.obj_line, incr_y()) {
 						int i_x = img.ox;
 						auto incr_x = [&] { i_x++; if (i_x >= img.w) i_x -= img.w; };
 
@@ -824,17 +950,19 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 				});
 			}
 			else {
+				MultiThread::chunks rows{ multi_thread, src_h };
 				multi_thread(src_h, [&, in_w = src_w - 2 * result.displace](int thread_id, int thread_num) {
-					for (int y = thread_id; y < src_h; y += thread_num) {
+					for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 						int i_x = img.ox, i_y = (y + img.oy) % img.h;
 						auto incr_x = [&] { i_x++; if (i_x >= img.w) i_x -= img.w; };
 
-						auto* dst = efpip->obj_edit + y * efpip->obj_line;
+						auto* dst = fr.obj_edit + y * fr.obj_line;
 						if (y < result.displace || y >= src_h - result.displace) {
 							for (int x = src_w; --x >= 0; dst++, incr_x()) *dst = paint(*dst, i_x, i_y);
 						}
 						else {
-							auto* src = reinterpret_cast<i16*>(efpip->obj_temp) + (y - result.displace) * result.a_stride;
+							auto* src = reinterpret_cast<i16*>(fr.obj_temp) + (y - result.displace) * result.a_stride;
+							if (lazy) buff::clear_alpha_margin(src, in_w, y - result.displace, margins);
 							for (int x = result.displace; --x >= 0; dst++, incr_x()) *dst = paint(*dst, i_x, i_y);
 							for (int x = in_w; --x >= 0; src++, dst++, incr_x()) *dst = blend(*src, *dst, i_x, i_y);
 							for (int x = result.displace; --x >= 0; dst++, incr_x()) *dst = paint(*dst, i_x, i_y);
@@ -845,7 +973,7 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 		}
 		else {
 			// fill with specified color.
-			auto col = buff::fromRGB(exdata->color.r, exdata->color.g, exdata->color.b);
+			auto col = buff::fromRGB(p.color.r, p.color.g, p.color.b);
 			auto blend = [&](i16 defl, ExEdit::PixelYCA const& orig) noexcept -> ExEdit::PixelYCA {
 				int a = (alpha * (max_alpha - defl)) >> log2_max_alpha,
 					A = static_cast<uint32_t>(orig.a * (max_alpha - a)) >> log2_max_alpha; // making sure A >= 0.
@@ -870,22 +998,24 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 				// the entire image is re-colored.
 				multi_thread(src_h, [&](int thread_id, int thread_num) {
 					int const y0 = src_h * thread_id / thread_num, y1 = src_h * (thread_id + 1) / thread_num;
-					auto* dst_y = efpip->obj_edit + y0 * efpip->obj_line;
-					for (int y = y1 - y0; --y >= 0; dst_y += efpip->obj_line) {
+					auto* dst_y = fr.obj_edit + y0 * fr.obj_line;
+					for (int y = y1 - y0; --y >= 0; dst_y += fr.obj_line) {
 						auto* dst = dst_y;
 						for (int x = src_w; --x >= 0; dst++) *dst = paint(*dst);
 					}
 				});
 			}
 			else {
+				MultiThread::chunks rows{ multi_thread, src_h };
 				multi_thread(src_h, [&, in_w = src_w - 2 * result.displace](int thread_id, int thread_num) {
-					for (int y = thread_id; y < src_h; y += thread_num) {
-						auto* dst = efpip->obj_edit + y * efpip->obj_line;
+					for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+						auto* dst = fr.obj_edit + y * fr.obj_line;
 						if (y < result.displace || y >= src_h - result.displace) {
 							for (int x = src_w; --x >= 0; dst++) *dst = paint(*dst);
 						}
 						else {
-							auto* src = reinterpret_cast<i16*>(efpip->obj_temp) + (y - result.displace) * result.a_stride;
+							auto* src = reinterpret_cast<i16*>(fr.obj_temp) + (y - result.displace) * result.a_stride;
+							if (lazy) buff::clear_alpha_margin(src, in_w, y - result.displace, margins);
 							for (int x = result.displace; --x >= 0; dst++) *dst = paint(*dst);
 							for (int x = in_w; --x >= 0; src++, dst++) *dst = blend(*src, *dst);
 							for (int x = result.displace; --x >= 0; dst++) *dst = paint(*dst);
@@ -896,6 +1026,6 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 		}
 	}
 
-	return TRUE;
+	return true;
 }
 
@@ -11,17 +11,40 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 */
 
 #include <cstdint>
+#include <cstdlib>
+#include <algorithm>
 
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 
 #include "multi_thread.hpp"
+#include "result_cache.hpp"
+#include "sdf.hpp"
+#include "relative_path.hpp"
 #include "Border.hpp"
 #include "Rounding.hpp"
 #include "Outline.hpp"
 
 
+// the distance field shared by the filters stacked on the same object,
+// enabled by the environment variable.
+static constinit bool sdf_enabled = false;
+static Filter::Sdf::field sdf_shared{};
+
+// when to keep the alpha in 8 bits within the kernels, set by the environment variable.
+enum class alpha8_mode : int {
+	never = 0,
+	always = 1,
+	preview = 2, // unless saving a video.
+};
+static constinit alpha8_mode alpha8_when = alpha8_mode::never;
+
+// the factor to scale down the images in the previews, set by the environment variable.
+// saving a video always computes in full quality.
+static constinit int draft_factor = 1;
+
+
 ////////////////////////////////
 // 変数アドレス初期化．
 ////////////////////////////////
@@ -49,6 +72,113 @@ void ExEdit092::init_pointers(AviUtl::FilterPlugin* efp)
 	auto aviutl_base = reinterpret_cast<uintptr_t>(fp->hinst_parent);
 	multi_thread.init(fp->exfunc->exec_multi_thread_func,
 		reinterpret_cast<int32_t*>(aviutl_base + ofs_num_threads_address));
+
+	// the result cache on disk, enabled by the environment variables.
+	if (char const* const dir = std::getenv("CIRCLEBORDER_S_CACHE"); dir != nullptr && dir[0] != '\0') {
+		char const* const mb = std::getenv("CIRCLEBORDER_S_CACHE_MB");
+		Filter::Cache::setup(dir, (mb != nullptr ? std::strtoull(mb, nullptr, 10) : 1024) << 20);
+	}
+	if (char const* const sdf = std::getenv("CIRCLEBORDER_S_SDF"); sdf != nullptr)
+		sdf_enabled = std::atoi(sdf) != 0;
+	if (char const* const a8 = std::getenv("CIRCLEBORDER_S_ALPHA8"); a8 != nullptr)
+		alpha8_when = static_cast<alpha8_mode>(std::clamp(std::atoi(a8), 0, 2));
+	if (char const* const draft = std::getenv("CIRCLEBORDER_S_DRAFT"); draft != nullptr) {
+		int const f = std::atoi(draft);
+		draft_factor = f >= 4 ? 4 : f >= 2 ? 2 : 1;
+	}
+}
+
+
+////////////////////////////////
+// フィルタ処理のエントリポイント．
+////////////////////////////////
+
+// runs the processing on the object of `efpip`, and reflects the result to it.
+static inline BOOL run_on(ExEdit::FilterProcInfo* efpip, auto&& proc)
+{
+	bool const is_saving = exedit.fp->exfunc->is_saving(*exedit.editp) != FALSE;
+	Filter::frame fr{
+		.obj_edit = efpip->obj_edit, .obj_temp = efpip->obj_temp,
+		.obj_w = efpip->obj_w, .obj_h = efpip->obj_h, .obj_line = efpip->obj_line,
+		.max_w = exedit.yca_max_w, .max_h = exedit.yca_max_h,
+		.heap = *exedit.memory_ptr,
+		.sdf = sdf_enabled ? &sdf_shared : nullptr,
+		.alpha8 = alpha8_when == alpha8_mode::always ||
+			(alpha8_when == alpha8_mode::preview && !is_saving),
+		.draft = is_saving ? 1 : draft_factor,
+	};
+	bool const ret = proc(fr);
+
+	efpip->obj_edit = fr.obj_edit; efpip->obj_temp = fr.obj_temp;
+	efpip->obj_w = fr.obj_w; efpip->obj_h = fr.obj_h;
+	return ret ? TRUE : FALSE;
+}
+
+// the pattern image specified by the file path, loaded by ExEdit.
+static inline tiled_image::loader pattern_of(char const* file, ExEdit::Filter* efp)
+{
+	if (file == nullptr || file[0] == '\0') return {};
+	// ExEdit loads with the stride of the object image within its maximum size.
+	return [file, efp](ExEdit::PixelYCA* buffer, int, int, int& w, int& h) {
+		return efp->exfunc->load_image(buffer, relative_path::absolute{ file }.abs_path.data(), &w, &h, 0, 0) != 0;
+	};
+}
+
+BOOL Filter::Border::impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
+{
+	auto* const exdata = reinterpret_cast<Exdata*>(efp->exdata_ptr);
+	return run_on(efpip, [&](Filter::frame& fr) {
+		return process({
+			.size		= efp->track[idx_track::size	],
+			.neg_size	= efp->track[idx_track::neg_size],
+			.transp		= efp->track[idx_track::transp	],
+			.f_transp	= efp->track[idx_track::f_transp],
+			.blur		= efp->track[idx_track::blur	],
+			.param_a	= efp->track[idx_track::param_a	],
+			.img_x		= efp->track[idx_track::img_x	],
+			.img_y		= efp->track[idx_track::img_y	],
+			.algorithm = exdata->algorithm,
+			.color = { exdata->color.r, exdata->color.g, exdata->color.b },
+			.pattern = pattern_of(exdata->file, efp),
+		}, fr);
+	});
+}
+
+BOOL Filter::Rounding::impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
+{
+	auto* const exdata = reinterpret_cast<Exdata*>(efp->exdata_ptr);
+	return run_on(efpip, [&](Filter::frame& fr) {
+		return process({
+			.radius		= efp->track[idx_track::radius	],
+			.shrink		= efp->track[idx_track::shrink	],
+			.transp		= efp->track[idx_track::transp	],
+			.blur		= efp->track[idx_track::blur	],
+			.param_a	= efp->track[idx_track::param_a	],
+			.crop = efp->check[idx_check::crop] != check_data::unchecked,
+			.algorithm = exdata->algorithm,
+		}, fr);
+	});
+}
+
+BOOL Filter::Outline::impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
+{
+	auto* const exdata = reinterpret_cast<Exdata*>(efp->exdata_ptr);
+	return run_on(efpip, [&](Filter::frame& fr) {
+		return process({
+			.distance	= efp->track[idx_track::distance	],
+			.thickness	= efp->track[idx_track::thickness	],
+			.pos_rad	= efp->track[idx_track::pos_rad		],
+			.neg_rad	= efp->track[idx_track::neg_rad		],
+			.blur		= efp->track[idx_track::blur		],
+			.param_a	= efp->track[idx_track::param_a		],
+			.img_x		= efp->track[idx_track::img_x		],
+			.img_y		= efp->track[idx_track::img_y		],
+			.algorithm = exdata->algorithm,
+			.order = exdata->order,
+			.color = { exdata->color.r, exdata->color.g, exdata->color.b },
+			.pattern = pattern_of(exdata->file, efp),
+		}, fr);
+	});
 }
 
 
@@ -24,6 +24,8 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 using byte = uint8_t;
 #include <exedit.hpp>
 
+#include "filter_core.hpp"
+
 
 ////////////////////////////////
 // 主要情報源の変数アドレス．
@@ -65,15 +67,6 @@ namespace Filter
 		};
 	};
 
-	enum class Algorithm : uint32_t {
-		bin = 0,
-		bin2x = 1,
-		sum = 2,
-		max = 3,
-		max_fast = 4,
-	};
-	constexpr int algorithm_count = 5;
-
 	namespace gui
 	{
 		constexpr auto algorithm_names = "2値化\0002値化倍精度\0総和\0最大値(安定)\0最大値(高速)\0";
@@ -23,6 +23,7 @@ using byte = uint8_t;
 #include <exedit.hpp>
 
 #include "CircleBorder_S.hpp"
+#include "Outline_core.hpp"
 
 
 ////////////////////////////////
@@ -34,40 +35,6 @@ namespace Filter::Outline
 	{
 		FILTER_INFO("アウトラインσ");
 
-		// trackbars.
-		constexpr const char* track_names[]
-			= { "距離", "ライン幅", "凸半径", "凹半径", "ぼかし", "param_a", "画像X", "画像Y" };
-		constexpr int32_t
-			track_den[]			= {    10,     10,   10,   10,   10,   10,     1,     1 },
-			track_min[]			= { -5000, -40000,    0,    0,    0,    0, -4000, -4000 },
-			track_min_drag[]	= { -2000,  -2000,    0,    0,    0,    0, -1000, -1000 },
-			track_default[]		= {   100,    100,    0,    0,    0,  500,     0,     0 },
-			track_max_drag[]	= {  2000,   2000, 2000, 2000, 2000, 1000,  1000,  1000 },
-			track_max[]			= {  5000,   5000, 5000, 5000, 5000, 1000,  4000,  4000 };
-		constexpr int track_link[] = { 0, 0, 0, 0, 0, 0, 1, -1, };
-		namespace idx_track
-		{
-			enum id : int {
-				distance,
-				thickness,
-				pos_rad,
-				neg_rad,
-				blur,
-				param_a,
-				img_x,
-				img_y,
-			};
-			constexpr int count_entries = std::size(track_names);
-		};
-
-		static_assert(
-			std::size(track_names) == std::size(track_den) &&
-			std::size(track_names) == std::size(track_min) &&
-			std::size(track_names) == std::size(track_min_drag) &&
-			std::size(track_names) == std::size(track_default) &&
-			std::size(track_names) == std::size(track_max_drag) &&
-			std::size(track_names) == std::size(track_max));
-
 		// checks.
 		constexpr const char* check_names[]
 			= { gui::algorithm_names, "速い方\0縮小→拡大→縮小\0拡大→縮小→拡大\0", "縁色の設定", "パターン画像ファイル" };
@@ -87,12 +54,6 @@ namespace Filter::Outline
 		static_assert(std::size(check_names) == std::size(check_default));
 
 		// exdata.
-		enum class FilterOrder : uint32_t {
-			faster = 0,
-			infl_once = 1,
-			defl_once = 2,
-		};
-		constexpr int filter_order_count = 3;
 		constexpr ExEdit::ExdataUse exdata_use[] =
 		{
 			{ .type = ExEdit::ExdataUse::Type::Number, .size = sizeof(uint16_t), .name = "kind" },
@@ -0,0 +1,83 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+
+#include "filter_core.hpp"
+#include "tiled_image.hpp"
+
+
+////////////////////////////////
+// 仕様書（処理部分）．
+////////////////////////////////
+namespace Filter::Outline
+{
+	namespace impl
+	{
+		// trackbars.
+		constexpr const char* track_names[]
+			= { "距離", "ライン幅", "凸半径", "凹半径", "ぼかし", "param_a", "画像X", "画像Y" };
+		constexpr int32_t
+			track_den[]			= {    10,     10,   10,   10,   10,   10,     1,     1 },
+			track_min[]			= { -5000, -40000,    0,    0,    0,    0, -4000, -4000 },
+			track_min_drag[]	= { -2000,  -2000,    0,    0,    0,    0, -1000, -1000 },
+			track_default[]		= {   100,    100,    0,    0,    0,  500,     0,     0 },
+			track_max_drag[]	= {  2000,   2000, 2000, 2000, 2000, 1000,  1000,  1000 },
+			track_max[]			= {  5000,   5000, 5000, 5000, 5000, 1000,  4000,  4000 };
+		constexpr int track_link[] = { 0, 0, 0, 0, 0, 0, 1, -1, };
+		namespace idx_track
+		{
+			enum id : int {
+				distance,
+				thickness,
+				pos_rad,
+				neg_rad,
+				blur,
+				param_a,
+				img_x,
+				img_y,
+			};
+			constexpr int count_entries = std::size(track_names);
+		};
+
+		static_assert(
+			std::size(track_names) == std::size(track_den) &&
+			std::size(track_names) == std::size(track_min) &&
+			std::size(track_names) == std::size(track_min_drag) &&
+			std::size(track_names) == std::size(track_default) &&
+			std::size(track_names) == std::size(track_max_drag) &&
+			std::size(track_names) == std::size(track_max));
+
+		enum class FilterOrder : uint32_t {
+			faster = 0,
+			infl_once = 1,
+			defl_once = 2,
+		};
+		constexpr int filter_order_count = 3;
+	}
+
+	// parameters of the filter, in the units of the trackbars.
+	struct params {
+		int distance, thickness, pos_rad, neg_rad, blur, param_a, img_x, img_y;
+		Algorithm algorithm;
+		impl::FilterOrder order;
+		struct { uint8_t r, g, b; } color;
+		tiled_image::loader pattern; // empty if the color is used instead.
+	};
+
+	// applies the filter onto `fr`.
+	// returns false if the image turned empty, invalidating subsequent filters.
+	bool process(params const& p, frame& fr);
+}
@@ -12,16 +12,16 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 
 #include <cstdint>
 #include <algorithm>
-
-#define NOMINMAX
-#define WIN32_LEAN_AND_MEAN
-using byte = uint8_t;
-#include <exedit.hpp>
+#include <optional>
+#include <utility>
 
 #include "arithmetics.hpp"
 #include "multi_thread.hpp"
 #include "buffer_op.hpp"
 #include "tiled_image.hpp"
+#include "result_cache.hpp"
+#include "sdf.hpp"
+#include "draft.hpp"
 
 #include "kind_bin/inf_def.hpp"
 #include "kind_bin2x/inf_def.hpp"
@@ -29,10 +29,11 @@ using byte = uint8_t;
 #include "kind_max_fast/inf_def.hpp"
 #include "kind_sum/inf_def.hpp"
 
-#include "Outline.hpp"
+#include "Outline_core.hpp"
 
 using namespace Filter::Outline;
 using namespace Calculation;
+using Filter::frame;
 namespace Outline_filter::params
 {
 	using namespace impl;
@@ -87,38 +88,45 @@ protected:
 		bool valid;
 	};
 
-	static size_t obj_mem_max() {
-		return sizeof(ExEdit::PixelYCA) * ((exedit.yca_max_w + 8) * (exedit.yca_max_h + 4) - 4);
-	}
-	static std::pair<int, int> max_size_cand(size_t pix_max) {
+	static std::pair<int, int> max_size_cand(size_t pix_max, int yca_max_w, int yca_max_h) {
 		int w, h = w = static_cast<int>(std::sqrt(pix_max)) & (-4);
-		if (w < exedit.yca_max_w) {
-			w = (exedit.yca_max_w + 3) & (-4);
+		if (w < yca_max_w) {
+			w = (yca_max_w + 3) & (-4);
 			h = (pix_max / w + 3) & (-4);
 		}
-		else if (h < exedit.yca_max_h) {
-			h = (exedit.yca_max_h + 3) & (-4);
+		else if (h < yca_max_h) {
+			h = (yca_max_h + 3) & (-4);
 			w = (pix_max / h + 3) & (-4);
 		}
 		return { w, h };
 	}
-	virtual std::tuple<int, int> max_size() const = 0;
+	virtual std::tuple<int, int> max_size(int yca_max_w, int yca_max_h) const = 0;
 	virtual process_spec tell_spec(int size_raw, bool is_final) const = 0;
+	// rough time of a pass of `size_raw` over `pixels` pixels, in nanoseconds on a single thread.
+	// fitted to the timings of the kernels, only to compare the orders of the passes.
+	virtual double pass_cost(int size_raw, double pixels) const = 0;
 
 	virtual Bounds inflate_med(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const = 0;
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, row_sink const* sink) const = 0;
 	virtual Bounds deflate_med(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
 		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const = 0;
 	virtual Bounds inflate(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const {
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, row_sink const* sink) const {
 		return inflate_med(size_raw, param_a, src_buf, src_colored, src_stride,
-			src_w, src_h, dst_buf, dst_stride, heap);
+			src_w, src_h, dst_buf, dst_stride, heap, sink);
 	}
 	virtual Bounds deflate(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
 		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const {
 		return deflate_med(size_raw, param_a, src_buf, src_colored, src_stride,
 			src_w, src_h, dst_buf, dst_stride, heap);
 	}
+	// derives the first pass on the source from the distance field of `fr` instead, if the algorithm allows.
+	virtual std::optional<Bounds> infdef_sdf(int size_raw, int param_a,
+		i16* dst_buf, size_t dst_stride, frame const& fr) const { return std::nullopt; }
+	// how the draft mode scales down the source, to inflate first if `inflates`, or to deflate.
+	virtual Filter::Draft::pool draft_pool(bool inflates) const {
+		return inflates ? Filter::Draft::pool::max : Filter::Draft::pool::min;
+	}
 
 private:
 	struct sizing {
@@ -127,19 +135,58 @@ private:
 			blur_size_raw, blur_displace,
 			final_displace;
 		bool has_hole, is_empty, zero_sized;
+		bool trimmed; // the sizes were reduced to fit in the memory.
 	};
 	sizing measure(int distance_raw, int pos_rad_raw, int neg_rad_raw, int thick_raw, int blur_px,
-		int src_w, int src_h, FilterOrder order) const
+		int src_w, int src_h, int yca_max_w, int yca_max_h, FilterOrder order) const
+	{
+		auto ret = measure_order(distance_raw, pos_rad_raw, neg_rad_raw, thick_raw, blur_px,
+			src_w, src_h, yca_max_w, yca_max_h, order);
+		if (order != FilterOrder::faster) return ret;
+
+		// the sign of the distance tells the faster order in most cases,
+		// so the other is taken only if it fits without trimming, or is clearly cheaper.
+		double cost = estimate_cost(ret, src_w, src_h);
+		for (auto const alt : { FilterOrder::infl_once, FilterOrder::defl_once }) {
+			auto const sz = measure_order(distance_raw, pos_rad_raw, neg_rad_raw, thick_raw, blur_px,
+				src_w, src_h, yca_max_w, yca_max_h, alt);
+			double const alt_cost = estimate_cost(sz, src_w, src_h);
+			if (sz.trimmed != ret.trimmed ? ret.trimmed : alt_cost < 0.9 * cost)
+				ret = sz, cost = alt_cost;
+		}
+		return ret;
+	}
+
+	// estimated time of the passes of `sz` on the image of the size `src_w` x `src_h`.
+	double estimate_cost(sizing const& sz, int src_w, int src_h) const
+	{
+		if (sz.zero_sized || sz.is_empty) return 0;
+
+		double cost = 0; int displace = 0;
+		auto add_pass = [&](int size_raw, int pass_displace) {
+			// inflations take time by the size of the result, deflations by that of the source.
+			int const d = std::max(displace, displace + pass_displace);
+			cost += pass_cost(size_raw,
+				static_cast<double>(std::max(src_w + 2 * d, 0)) * std::max(src_h + 2 * d, 0));
+			displace += pass_displace;
+		};
+		for (int i = 0; i < sz.pass1_cnt; i++) add_pass(sz.pass1_infl[i], sz.pass1_displace[i]);
+		if (sz.has_hole) add_pass(sz.pass2_infl, sz.pass2_displace);
+		return cost;
+	}
+
+	sizing measure_order(int distance_raw, int pos_rad_raw, int neg_rad_raw, int thick_raw, int blur_px,
+		int src_w, int src_h, int yca_max_w, int yca_max_h, FilterOrder order) const
 	{
 		constexpr sizing zero_sized = { .zero_sized = true };
 
-		auto const [max_w, max_h] = max_size();
+		auto const [max_w, max_h] = max_size(yca_max_w, yca_max_h);
 		int const
 			max_displace = std::min(max_w - src_w, max_h - src_h) >> 1,
 			min_displace = -(std::min(src_w, src_h) >> 1);
-		int const max_final_displace = std::min(exedit.yca_max_w - src_w, exedit.yca_max_h - src_h) >> 1;
-		while (true) {
-			sizing ret{};
+		int const max_final_displace = std::min(yca_max_w - src_w, yca_max_h - src_h) >> 1;
+		for (bool trimmed = false; ; trimmed = true) {
+			sizing ret{ .trimmed = trimmed };
 			blur_px = std::clamp(blur_px, 0, std::max((arith::abs(thick_raw) >> 1) - den_distance, 0));
 			static_assert(((-min_thickness) >> 1) - den_distance > max_blur);
 
@@ -248,124 +295,164 @@ public:
 	struct outline_result {
 		int displace, stride;
 		Bounds bd;
+		bool colored; // the result is left on the alpha channel of the image.
 		bool is_empty, zero_sized;
+
+		// where the alpha values are, for the result made from `fr`.
+		Filter::Cache::plane plane(frame const& fr) const
+		{
+			if (zero_sized || is_empty) return {};
+			return {
+				.buf = colored ? &fr.obj_edit->a : reinterpret_cast<i16*>(fr.obj_edit),
+				.step = colored ? 4u : 1u, .stride = static_cast<size_t>(stride),
+				.bd = bd,
+			};
+		}
 	};
 
 	outline_result operator()(int distance_raw, int pos_rad_raw, int neg_rad_raw, int thick_raw, int blur_px, int param_a,
-		FilterOrder order, ExEdit::FilterProcInfo* efpip) const
+		FilterOrder order, frame& fr) const
 	{
 		constexpr outline_result zero_sized{ .zero_sized = true };
-		int const src_w = efpip->obj_w, src_h = efpip->obj_h;
+		int const src_w = fr.obj_w, src_h = fr.obj_h;
 
-		auto sz = measure(distance_raw, pos_rad_raw, neg_rad_raw, thick_raw, blur_px, src_w, src_h, order);
+		auto sz = measure(distance_raw, pos_rad_raw, neg_rad_raw, thick_raw, blur_px, src_w, src_h, fr.max_w, fr.max_h, order);
 		if (sz.zero_sized) return zero_sized; // zero-sized.
-		if (sz.is_empty) {
-			// valid size, filled with transparent pixels.
+		// valid size, filled with transparent pixels.
+		outline_result const empty{
+			.displace = sz.final_displace,
+			.is_empty = true,
+		};
+		if (sz.is_empty) return empty;
+
+		// the stride of the plane for the final result.
+		size_t const stride = (src_w + 2 * sz.final_displace + 1) & (-2);
+
+		int radius_raw = sz.has_hole ? arith::abs(sz.pass2_infl) : 0;
+		for (int i = 0; i < sz.pass1_cnt; i++) radius_raw = std::max(radius_raw, arith::abs(sz.pass1_infl[i]));
+		if (auto const pool = draft_pool((sz.pass1_cnt > 0 ? sz.pass1_infl[0] : sz.pass2_infl) > 0);
+			Filter::Draft::applies(fr, pool, radius_raw / den_distance)) {
+			// compute on the scaled-down image, and scale the result up.
+			int const f = fr.draft;
+			frame small = Filter::Draft::reduce(fr, pool);
+			auto const result = (*this)(distance_raw / f, pos_rad_raw / f, neg_rad_raw / f,
+				thick_raw <= min_thickness ? thick_raw : thick_raw / f, blur_px / f, param_a, order, small);
+			if (result.zero_sized || result.is_empty) return empty;
+
+			int const dst_w = src_w + 2 * sz.final_displace, dst_h = src_h + 2 * sz.final_displace;
+			Filter::Draft::expand(result.plane(small), -result.displace, f,
+				reinterpret_cast<i16*>(fr.obj_temp), 1, stride, dst_w, dst_h, -sz.final_displace);
+			std::swap(fr.obj_edit, fr.obj_temp);
 			return {
 				.displace = sz.final_displace,
-				.is_empty = true
+				.stride = static_cast<int>(stride),
+				.bd = { 0, 0, dst_w, dst_h },
 			};
 		}
 
-		outline_result ret{
-			.displace = sz.final_displace,
-			.stride = (src_w + 2 * sz.final_displace + 1) & (-2),
+		// the alpha values of the image are read in place by whichever pass comes first,
+		// and each pass writes only the values it changes.
+		plane img{
+			.buf = &fr.obj_edit->a, .step = 4, .stride = 4 * static_cast<size_t>(fr.obj_line),
 			.bd = { 0, 0, src_w, src_h },
 		};
 
-		size_t stride = 4 * efpip->obj_line;
 		// first pass to create a curve at the specified distance and curvatures.
-		if (sz.pass1_cnt == 0) {
-			stride = (efpip->obj_w + 1) & (-2);
-			buff::copy_alpha(efpip->obj_edit, efpip->obj_line, 0, 0, src_w, src_h,
-				reinterpret_cast<i16*>(efpip->obj_temp), stride, 0, 0);
-			std::swap(efpip->obj_edit, efpip->obj_temp);
-		}
-		else {
-			for (int i = 0; i < sz.pass1_cnt; i++) {
-				bool dst_final = i == sz.pass1_cnt - 1;
-				size_t src_stride = std::exchange(stride,
-					dst_final && (!sz.has_hole || sz.pass2_infl < 0) ?
-					ret.stride : ((ret.bd.wd() + 2 * sz.pass1_displace[i] + 1) & (-2)));
-				infdef(sz.pass1_infl[i], sz.pass1_displace[i], param_a,
-					i == 0, src_stride, dst_final, stride, ret.bd, efpip);
-				if (ret.bd.is_empty()) return {
-					.displace = sz.final_displace,
-					.is_empty = true,
-				};
-			}
+		for (int i = 0; i < sz.pass1_cnt; i++) {
+			bool dst_final = i == sz.pass1_cnt - 1;
+			img = infdef(sz.pass1_infl[i], param_a, img,
+				dst_final && (!sz.has_hole || sz.pass2_infl < 0) ?
+					stride : ((img.bd.wd() + 2 * sz.pass1_displace[i] + 1) & (-2)),
+				dst_final, fr);
+			if (img.bd.is_empty()) return empty;
 		}
 
 		// carving the hole by the second pass.
 		if (sz.has_hole) {
-			Bounds bd2 = ret.bd;
-			size_t stride2 = sz.pass2_infl > 0 ?
-				ret.stride : (ret.bd.wd() + 2 * sz.pass2_displace + 1) & (-2);
-			infdef(sz.pass2_infl, sz.pass2_displace, param_a, false, stride, true, stride2, bd2, efpip);
-			if (bd2.is_empty()) {
-				if (sz.pass2_infl > 0) return {
-					.displace = sz.final_displace,
-					.is_empty = true,
-				};
+			if (sz.pass2_infl > 0) {
+				// the larger image is the new one, carved by the image from before the pass as it's written.
+				plane const hole = img.move(sz.pass2_displace, sz.pass2_displace);
+				img = infdef(sz.pass2_infl, param_a, img, stride, true, fr, &hole);
+				if (img.bd.is_empty()) return empty;
 			}
 			else {
-				// there is a hole.
-				// move the larger image to obj_temp.
-				if (sz.pass2_infl > 0) {
-					std::swap(efpip->obj_edit, efpip->obj_temp);
-					std::swap(ret.bd, bd2);
-					std::swap(stride, stride2);
-				}
-
-				// carve the image.
-				multi_thread(bd2.ht(), [&](int thread_id, int thread_num) {
-					int y0 = bd2.T + bd2.ht() * thread_id / thread_num,
-						y1 = bd2.T + bd2.ht() * (thread_id + 1) / thread_num;
-					auto src = reinterpret_cast<i16*>(efpip->obj_edit)
-							+ bd2.L + y0 * stride2,
-						dst = reinterpret_cast<i16*>(efpip->obj_temp)
-							+ bd2.L + y0 * stride
-							+ arith::abs(sz.pass2_displace) * (1 + stride);
-
-					for (int y = y1 - y0; --y >= 0; src += stride2, dst += stride) {
-						auto src_y = src, dst_y = dst;
-						for (int x = bd2.wd(); --x >= 0; src_y++, dst_y++)
-							*dst_y = std::max(*dst_y - *src_y, 0);
-					}
-				});
+				// carve the image from before the pass, which the pass reads until the end.
+				plane const img2 = infdef(sz.pass2_infl, param_a, img,
+					(img.bd.wd() + 2 * sz.pass2_displace + 1) & (-2), true, fr);
+				std::swap(fr.obj_edit, fr.obj_temp);
+				carve(img, img2.move(-sz.pass2_displace, -sz.pass2_displace));
 			}
-			std::swap(efpip->obj_edit, efpip->obj_temp);
 		}
 
 		// apply blur.
 		if (sz.blur_size_raw > 0) {
-			buff::blur_alpha(reinterpret_cast<i16*>(efpip->obj_edit), ret.stride,
-				ret.bd.L, ret.bd.T, ret.bd.wd(), ret.bd.ht(), (sz.blur_size_raw * buff::den_blur_px) / den_blur,
-				*exedit.memory_ptr);
-			ret.bd = ret.bd.inflate_br(2 * sz.blur_displace, 2 * sz.blur_displace);
+			int const blur = (sz.blur_size_raw * buff::den_blur_px) / den_blur;
+			if (img.colored())
+				buff::blur_alpha(fr.obj_edit, fr.obj_line,
+					img.bd.L, img.bd.T, img.bd.wd(), img.bd.ht(), blur, fr.heap);
+			else buff::blur_alpha(img.buf, img.stride,
+				img.bd.L, img.bd.T, img.bd.wd(), img.bd.ht(), blur, fr.heap);
+			img.bd = img.bd.inflate_br(2 * sz.blur_displace, 2 * sz.blur_displace);
 		}
 
-		return ret;
+		return {
+			.displace = sz.final_displace,
+			.stride = static_cast<int>(img.stride),
+			.bd = img.bd,
+			.colored = img.colored(),
+		};
 	}
 
 private:
-	void infdef(int size, int displace, int param_a, bool src_colored, size_t src_stride, bool dst_final, size_t dst_stride,
-		Bounds& bd, ExEdit::FilterProcInfo* efpip) const
+	// runs a pass from `src` to a plane with `dst_stride` on `fr.obj_temp`, returning that plane.
+	// `fr.obj_edit` and `fr.obj_temp` are swapped afterward, so the result is on `fr.obj_edit`.
+	// the values of `hole` are subtracted from the result of an inflation, if given.
+	plane infdef(int size, int param_a, plane const& src, size_t dst_stride, bool dst_final, frame& fr,
+		plane const* hole = nullptr) const
 	{
+		auto const& bd = src.bd;
 		auto const
-			src_buf = (src_colored ? &efpip->obj_edit->a : reinterpret_cast<i16*>(efpip->obj_edit))
-				+ bd.L * (src_colored ? 4 : 1) + bd.T * src_stride,
-			dst_buf = reinterpret_cast<i16*>(efpip->obj_temp)
-				+ bd.L + bd.T * dst_stride;
-
-		bd = (this->*(size > 0 ?
-			dst_final ? &outline_base::inflate : &outline_base::inflate_med :
-			dst_final ? &outline_base::deflate : &outline_base::deflate_med))(
-				size, param_a, src_buf, src_colored, src_stride,
-				bd.wd(), bd.ht(), dst_buf, dst_stride, *exedit.memory_ptr)
-			.move(bd.L, bd.T);
+			src_buf = src.at(bd.L, bd.T),
+			dst_buf = reinterpret_cast<i16*>(fr.obj_temp) + bd.L + bd.T * dst_stride;
+
+		// the distance field is of the image, available only when reading it.
+		Bounds dst_bd; bool carved = false;
+		if (auto const sdf_bd = src.colored() ?
+			infdef_sdf(size, param_a, dst_buf, dst_stride, fr) : std::nullopt) dst_bd = *sdf_bd;
+		else if (size > 0) {
+			// the kernels take `hole` relative to `dst_buf`.
+			row_sink const hole_dst{ .carve = hole != nullptr ? hole->move(-bd.L, -bd.T) : plane{} };
+			dst_bd = (this->*(dst_final ? &outline_base::inflate : &outline_base::inflate_med))(
+				size, param_a, src_buf, src.colored(), src.stride,
+				bd.wd(), bd.ht(), dst_buf, dst_stride, fr.heap, hole != nullptr ? &hole_dst : nullptr);
+			carved = true;
+		}
+		else dst_bd = (this->*(dst_final ? &outline_base::deflate : &outline_base::deflate_med))(
+			size, param_a, src_buf, src.colored(), src.stride,
+			bd.wd(), bd.ht(), dst_buf, dst_stride, fr.heap);
+
+		std::swap(fr.obj_edit, fr.obj_temp);
+		plane const ret{
+			.buf = reinterpret_cast<i16*>(fr.obj_edit), .step = 1, .stride = dst_stride,
+			.bd = dst_bd.move(bd.L, bd.T),
+		};
+		if (hole != nullptr && !carved) carve(ret, *hole);
+		return ret;
+	}
 
-		std::swap(efpip->obj_edit, efpip->obj_temp);
+	// subtracts `src` from `dst` within the bounds of `src`, clamping at zero.
+	static void carve(plane const& dst, plane const& src)
+	{
+		auto const& bd = src.bd;
+		multi_thread(bd.ht(), [&](int thread_id, int thread_num) {
+			int y0 = bd.T + bd.ht() * thread_id / thread_num,
+				y1 = bd.T + bd.ht() * (thread_id + 1) / thread_num;
+			for (int y = y0; y < y1; y++) {
+				auto src_x = src.at(bd.L, y), dst_x = dst.at(bd.L, y);
+				for (int x = bd.wd(); --x >= 0; src_x += src.step, dst_x += dst.step)
+					*dst_x = std::max(*dst_x - *src_x, 0);
+			}
+		});
 	}
 };
 
@@ -374,6 +461,8 @@ protected:
 	static constexpr i16 to_thresh(int param_a) {
 		return (max_alpha - 1) * param_a / max_param_a;
 	}
+	// these run fast enough for any radius, faster than scaling up the result.
+	Filter::Draft::pool draft_pool(bool inflates) const override { return Filter::Draft::pool::none; }
 	process_spec tell_spec(int size_raw, bool is_final) const override {
 		int const displace = size_raw > 0 ?
 			+bin::inflate_radius<den_distance>(+size_raw) :
@@ -383,11 +472,13 @@ protected:
 			.valid = displace != 0,
 		};
 	}
+	// hardly depends on the radius.
+	double pass_cost(int size_raw, double pixels) const override { return 10 * pixels; }
 	Bounds inflate_med(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const {
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, row_sink const* sink) const {
 		return bin::inflate(src_w, src_h, src_buf,
 			src_colored, src_stride, to_thresh(param_a),
-			dst_buf, false, dst_stride, heap, (size_raw * size_raw) / (den_distance * den_distance));
+			dst_buf, false, dst_stride, heap, (size_raw * size_raw) / (den_distance * den_distance), sink);
 	}
 	Bounds deflate_med(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
 		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const {
@@ -398,13 +489,15 @@ protected:
 };
 
 // algorithm "bin".
-constexpr struct : outline_bin_base {
+constexpr struct outline_bin : outline_bin_base {
 private:
-	static inline constinit int mem_max_w = 0, mem_max_h = 0;
-	static void init_mem_max()
+	// cached for each thread, as frames of different sizes may run in parallel.
+	static inline thread_local constinit int mem_max_w = 0, mem_max_h = 0, yca_w = 0, yca_h = 0;
+	static void init_mem_max(int yca_max_w, int yca_max_h)
 	{
-		size_t const mem_max = obj_mem_max();
-		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / sizeof(i32));
+		yca_w = yca_max_w; yca_h = yca_max_h;
+		size_t const mem_max = frame::heap_size(yca_max_w, yca_max_h);
+		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / sizeof(i32), yca_max_w, yca_max_h);
 
 		// trim by 4 dots until it fits within available space.
 		while (sizeof(i16) * ((mem_max_w + 1) & (-2)) * mem_max_h > mem_max ||
@@ -413,20 +506,31 @@ private:
 	}
 
 protected:
-	std::tuple<int, int> max_size() const override {
-		if (mem_max_w == 0) init_mem_max();
+	std::tuple<int, int> max_size(int yca_max_w, int yca_max_h) const override {
+		if (yca_w != yca_max_w || yca_h != yca_max_h) init_mem_max(yca_max_w, yca_max_h);
 		return { mem_max_w, mem_max_h };
 	}
+	std::optional<Bounds> infdef_sdf(int size_raw, int param_a,
+		i16* dst_buf, size_t dst_stride, frame const& fr) const override
+	{
+		auto* const field = Filter::Sdf::of(fr, to_thresh(param_a));
+		if (field == nullptr) return std::nullopt;
+		int const size_sq = (size_raw * size_raw) / (den_distance * den_distance);
+		return size_raw > 0 ?
+			Filter::Sdf::inflate(*field, size_sq, dst_buf, false, dst_stride) :
+			Filter::Sdf::deflate(*field, size_sq, dst_buf, false, dst_stride);
+	}
 } outline_bin{};
 
 // algorithm "bin2x".
-constexpr struct : outline_bin_base {
+constexpr struct outline_bin2x : outline_bin_base {
 private:
-	static inline constinit int mem_max_w = 0, mem_max_h = 0;
-	static void init_mem_max()
+	static inline thread_local constinit int mem_max_w = 0, mem_max_h = 0, yca_w = 0, yca_h = 0;
+	static void init_mem_max(int yca_max_w, int yca_max_h)
 	{
-		size_t const mem_max = obj_mem_max();
-		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / sizeof(i32));
+		yca_w = yca_max_w; yca_h = yca_max_h;
+		size_t const mem_max = frame::heap_size(yca_max_w, yca_max_h);
+		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / sizeof(i32), yca_max_w, yca_max_h);
 
 		// trim by 4 dots until it fits within available space.
 		while (sizeof(i16) * ((mem_max_w + 1) & (-2)) * mem_max_h > mem_max ||
@@ -435,8 +539,8 @@ private:
 	}
 
 protected:
-	std::tuple<int, int> max_size() const override {
-		if (mem_max_w == 0) init_mem_max();
+	std::tuple<int, int> max_size(int yca_max_w, int yca_max_h) const override {
+		if (yca_w != yca_max_w || yca_h != yca_max_h) init_mem_max(yca_max_w, yca_max_h);
 		return { mem_max_w, mem_max_h };
 	}
 	process_spec tell_spec(int size_raw, bool is_final) const override {
@@ -451,11 +555,13 @@ protected:
 		}
 		else return outline_bin_base::tell_spec(size_raw, is_final);
 	}
+	// the final pass is of bin2x, and the others are of bin.
+	double pass_cost(int size_raw, double pixels) const override { return 6 * pixels; }
 	Bounds inflate(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const override {
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, row_sink const* sink) const override {
 		return bin2x::inflate(src_w, src_h,
 			src_buf, src_colored, src_stride, to_thresh(param_a),
-			dst_buf, false, dst_stride, heap, (4 * size_raw * size_raw) / (den_distance * den_distance));
+			dst_buf, false, dst_stride, heap, (4 * size_raw * size_raw) / (den_distance * den_distance), sink);
 	}
 	Bounds deflate(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
 		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const override {
@@ -466,13 +572,15 @@ protected:
 } outline_bin2x{};
 
 // algorithm "max".
-constexpr struct : outline_base {
+template<class P>
+struct outline_max : outline_base {
 private:
-	static inline constinit int mem_max_w = 0, mem_max_h = 0;
-	static void init_mem_max()
+	static inline thread_local constinit int mem_max_w = 0, mem_max_h = 0, yca_w = 0, yca_h = 0;
+	static void init_mem_max(int yca_max_w, int yca_max_h)
 	{
-		size_t const mem_max = obj_mem_max();
-		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / (2 * sizeof(i16)));
+		yca_w = yca_max_w; yca_h = yca_max_h;
+		size_t const mem_max = frame::heap_size(yca_max_w, yca_max_h);
+		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / (2 * sizeof(i16)), yca_max_w, yca_max_h);
 
 		// trim by 4 dots until it fits within available space.
 		while (sizeof(i16) * ((mem_max_w + 1) & (-2)) * mem_max_h
@@ -482,8 +590,8 @@ private:
 	}
 
 protected:
-	std::tuple<int, int> max_size() const override {
-		if (mem_max_w == 0) init_mem_max();
+	std::tuple<int, int> max_size(int yca_max_w, int yca_max_h) const override {
+		if (yca_w != yca_max_w || yca_h != yca_max_h) init_mem_max(yca_max_w, yca_max_h);
 		return { mem_max_w, mem_max_h };
 	}
 	process_spec tell_spec(int size_raw, bool is_final) const override {
@@ -495,34 +603,39 @@ protected:
 			.valid = displace != 0,
 		};
 	}
+	double pass_cost(int size_raw, double pixels) const override {
+		return (10 + 7 * (arith::abs(size_raw) / static_cast<double>(den_distance))) * pixels;
+	}
 	Bounds inflate_med(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const {
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, row_sink const* sink) const {
 		int const size_sq = (size_raw * size_raw) / (den_distance * den_distance);
 		return src_colored ?
-			max::inflate(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
-				dst_buf, false, dst_stride, heap, size_sq, dst_buf + dst_stride * mem_max_h) :
+			max::inflate<P>(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
+				dst_buf, false, dst_stride, heap, size_sq, dst_buf + dst_stride * mem_max_h, nullptr, sink) :
 			max::inflate(src_w, src_h, src_buf, src_stride,
-				dst_buf, false, dst_stride, heap, size_sq);
+				dst_buf, false, dst_stride, heap, size_sq, nullptr, sink);
 	}
 	Bounds deflate_med(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
 		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const {
 		int const size_sq = (size_raw * size_raw) / (den_distance * den_distance);
 		return src_colored ?
-			max::deflate(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
+			max::deflate<P>(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
 				dst_buf, false, dst_stride, heap, size_sq, dst_buf + dst_stride * mem_max_h) :
 			max::deflate(src_w, src_h, src_buf, src_stride,
 				dst_buf, false, dst_stride, heap, size_sq);
 	}
-} outline_max{};
+};
 
 // algorithm "max_fast".
-constexpr struct : outline_base {
+template<class P>
+struct outline_max_fast : outline_base {
 private:
-	static inline constinit int mem_max_w = 0, mem_max_h = 0;
-	static void init_mem_max()
+	static inline thread_local constinit int mem_max_w = 0, mem_max_h = 0, yca_w = 0, yca_h = 0;
+	static void init_mem_max(int yca_max_w, int yca_max_h)
 	{
-		size_t const mem_max = obj_mem_max();
-		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / (2 * sizeof(i16)));
+		yca_w = yca_max_w; yca_h = yca_max_h;
+		size_t const mem_max = frame::heap_size(yca_max_w, yca_max_h);
+		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / (2 * sizeof(i16)), yca_max_w, yca_max_h);
 
 		// trim by 4 dots until it fits within available space.
 		while (sizeof(i16) * ((mem_max_w + 1) & (-2)) * mem_max_h
@@ -532,8 +645,8 @@ private:
 	}
 
 protected:
-	std::tuple<int, int> max_size() const override {
-		if (mem_max_w == 0) init_mem_max();
+	std::tuple<int, int> max_size(int yca_max_w, int yca_max_h) const override {
+		if (yca_w != yca_max_w || yca_h != yca_max_h) init_mem_max(yca_max_w, yca_max_h);
 		return { mem_max_w, mem_max_h };
 	}
 	process_spec tell_spec(int size_raw, bool is_final) const override {
@@ -545,38 +658,43 @@ protected:
 			.valid = displace != 0,
 		};
 	}
+	double pass_cost(int size_raw, double pixels) const override {
+		return (8 + arith::abs(size_raw) / static_cast<double>(den_distance)) * pixels;
+	}
 	Bounds inflate_med(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const {
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, row_sink const* sink) const {
 		int const size_sq = (size_raw * size_raw) / (den_distance * den_distance);
 		return src_colored ?
-			max_fast::inflate(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
-				dst_buf, false, dst_stride, heap, size_sq, dst_buf + dst_stride * mem_max_h) :
+			max_fast::inflate<P>(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
+				dst_buf, false, dst_stride, heap, size_sq, dst_buf + dst_stride * mem_max_h, nullptr, sink) :
 			max_fast::inflate(src_w, src_h, src_buf, src_stride,
-				dst_buf, false, dst_stride, heap, size_sq);
+				dst_buf, false, dst_stride, heap, size_sq, nullptr, sink);
 	}
 	Bounds deflate_med(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
 		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const {
 		int const size_sq = (size_raw * size_raw) / (den_distance * den_distance);
 		return src_colored ?
-			max_fast::deflate(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
+			max_fast::deflate<P>(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
 				dst_buf, false, dst_stride, heap, size_sq, dst_buf + dst_stride * mem_max_h) :
 			max_fast::deflate(src_w, src_h, src_buf, src_stride,
 				dst_buf, false, dst_stride, heap, size_sq);
 	}
-} outline_max_fast{};
+};
 
 // algorithm "sum".
-constexpr struct : outline_base {
+template<class P>
+struct outline_sum : outline_base {
 	constexpr static int to_cap_rate(int param_a) {
 		return sum::den_cap_rate * param_a / max_param_a;
 	}
 
 private:
-	static inline constinit int mem_max_w = 0, mem_max_h = 0;
-	static void init_mem_max()
+	static inline thread_local constinit int mem_max_w = 0, mem_max_h = 0, yca_w = 0, yca_h = 0;
+	static void init_mem_max(int yca_max_w, int yca_max_h)
 	{
-		size_t const mem_max = obj_mem_max();
-		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / sizeof(i32));
+		yca_w = yca_max_w; yca_h = yca_max_h;
+		size_t const mem_max = frame::heap_size(yca_max_w, yca_max_h);
+		std::tie(mem_max_w, mem_max_h) = max_size_cand(mem_max / sizeof(i32), yca_max_w, yca_max_h);
 
 		// trim by 4 dots until it fits within available space.
 		while (sizeof(i16) * ((mem_max_w + 1) & (-2)) * mem_max_h
@@ -586,8 +704,8 @@ private:
 	}
 
 protected:
-	std::tuple<int, int> max_size() const override {
-		if (mem_max_w == 0) init_mem_max();
+	std::tuple<int, int> max_size(int yca_max_w, int yca_max_h) const override {
+		if (yca_w != yca_max_w || yca_h != yca_max_h) init_mem_max(yca_max_w, yca_max_h);
 		return { mem_max_w, mem_max_h };
 	}
 	process_spec tell_spec(int size_raw, bool is_final) const override {
@@ -599,41 +717,53 @@ protected:
 			.valid = size_raw >= den_distance || size_raw <= -den_distance,
 		};
 	}
+	double pass_cost(int size_raw, double pixels) const override {
+		return (10 + 3 * (arith::abs(size_raw) / static_cast<double>(den_distance))) * pixels;
+	}
+	Filter::Draft::pool draft_pool(bool inflates) const override { return Filter::Draft::pool::mean; }
 	Bounds inflate_med(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
-		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const {
+		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, row_sink const* sink) const {
 		int const size_sq = (size_raw * size_raw) / (den_distance * den_distance),
 			rate = to_cap_rate(param_a);
 		return src_colored ?
-			sum::inflate(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
+			sum::inflate<P>(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
 				dst_buf, false, dst_stride, rate,
-				heap, size_sq, dst_buf + dst_stride * mem_max_h) :
+				heap, size_sq, dst_buf + dst_stride * mem_max_h, nullptr, sink) :
 			sum::inflate(src_w, src_h, src_buf, src_stride,
 				dst_buf, false, dst_stride, rate,
-				heap, size_sq);
+				heap, size_sq, nullptr, sink);
 	}
 	Bounds deflate_med(int size_raw, int param_a, i16* src_buf, bool src_colored, size_t src_stride,
 		int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap) const {
 		int const size_sq = (size_raw * size_raw) / (den_distance * den_distance),
 			rate = to_cap_rate(param_a);
 		return src_colored ?
-			sum::deflate(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
+			sum::deflate<P>(src_w, src_h, buff::alpha_to_pixel(src_buf), src_stride / 4,
 				dst_buf, false, dst_stride, rate,
 				heap, size_sq, dst_buf + dst_stride * mem_max_h) :
 			sum::deflate(src_w, src_h, src_buf, src_stride,
 				dst_buf, false, dst_stride, rate,
 				heap, size_sq);
 	}
-} outline_sum{};
+};
+
+constexpr outline_max<alpha12> outline_max_12{};
+constexpr outline_max<alpha8> outline_max_8{};
+constexpr outline_max_fast<alpha12> outline_max_fast_12{};
+constexpr outline_max_fast<alpha8> outline_max_fast_8{};
+constexpr outline_sum<alpha12> outline_sum_12{};
+constexpr outline_sum<alpha8> outline_sum_8{};
 
-constexpr outline_base const& choose_outline(Filter::Algorithm algorithm) {
+// `use_alpha8` has no effect on "bin" and "bin2x", which see only whether pixels are opaque.
+constexpr outline_base const& choose_outline(Filter::Algorithm algorithm, bool use_alpha8) {
 	switch (algorithm) {
 		using algo = Filter::Algorithm;
 	case algo::bin: return outline_bin;
 	default:
 	case algo::bin2x: return outline_bin2x;
-	case algo::max: return outline_max;
-	case algo::max_fast: return outline_max_fast;
-	case algo::sum: return outline_sum;
+	case algo::max: if (use_alpha8) return outline_max_8; return outline_max_12;
+	case algo::max_fast: if (use_alpha8) return outline_max_fast_8; return outline_max_fast_12;
+	case algo::sum: if (use_alpha8) return outline_sum_8; return outline_sum_12;
 	}
 }
 
@@ -641,70 +771,79 @@ constexpr outline_base const& choose_outline(Filter::Algorithm algorithm) {
 ////////////////////////////////
 // フィルタ処理のエントリポイント．
 ////////////////////////////////
-BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
+bool Filter::Outline::process(params const& p, frame& fr)
 {
-	int const src_w = efpip->obj_w, src_h = efpip->obj_h;
-	if (src_w <= 0 || src_h <= 0) return TRUE;
+	int const src_w = fr.obj_w, src_h = fr.obj_h;
+	if (src_w <= 0 || src_h <= 0) return true;
 
 	int const
-		distance	= std::clamp(efp->track[idx_track::distance	], min_distance	, max_distance	),
-		thickness	= std::clamp(efp->track[idx_track::thickness], min_thickness, max_thickness	),
-		pos_rad		= std::clamp(efp->track[idx_track::pos_rad	], min_pos_rad	, max_pos_rad	),
-		neg_rad		= std::clamp(efp->track[idx_track::neg_rad	], min_neg_rad	, max_neg_rad	),
-		blur_px		= std::clamp(efp->track[idx_track::blur		], min_blur		, max_blur		),
-		param_a		= std::clamp(efp->track[idx_track::param_a	], min_param_a	, max_param_a	),
-		img_x		= std::clamp(efp->track[idx_track::img_x	], min_img_x	, max_img_x		),
-		img_y		= std::clamp(efp->track[idx_track::img_y	], min_img_y	, max_img_y		);
-	auto* const exdata = reinterpret_cast<Exdata*>(efp->exdata_ptr);
+		distance	= std::clamp(p.distance	, min_distance	, max_distance	),
+		thickness	= std::clamp(p.thickness, min_thickness, max_thickness	),
+		pos_rad		= std::clamp(p.pos_rad	, min_pos_rad	, max_pos_rad	),
+		neg_rad		= std::clamp(p.neg_rad	, min_neg_rad	, max_neg_rad	),
+		blur_px		= std::clamp(p.blur		, min_blur		, max_blur		),
+		param_a		= std::clamp(p.param_a	, min_param_a	, max_param_a	),
+		img_x		= std::clamp(p.img_x	, min_img_x	, max_img_x		),
+		img_y		= std::clamp(p.img_y	, min_img_y	, max_img_y		);
+
+	int const ext = (std::max(distance, 0) + std::max(thickness, 0)) / den_distance;
+	MultiThread::serial_scope const serial{ multi_thread,
+		(src_w + 2 * ext) * (src_h + 2 * ext) < Filter::small_obj_area };
 
 	// handle trivial cases.
 	if (std::min(src_w, src_h) <= 2 * ((-distance - std::max(thickness, 0)) / den_distance)) {
 		// should turn empty.
-		efpip->obj_w = efpip->obj_h = 0;
-		return FALSE; // invalidate subsequent filters.
+		fr.obj_w = fr.obj_h = 0;
+		return false; // invalidate subsequent filters.
 	}
 
-	auto result = choose_outline(exdata->algorithm)(
-		distance, pos_rad, neg_rad, thickness,
-		blur_px, param_a, exdata->order, efpip);
+	auto result = Filter::Cache::through('O',
+		{ static_cast<int32_t>(p.algorithm), distance, pos_rad, neg_rad, thickness,
+			blur_px, param_a, static_cast<int32_t>(p.order), fr.alpha8, fr.draft }, fr,
+		[&](frame& f) { return choose_outline(p.algorithm, fr.alpha8)(
+			distance, pos_rad, neg_rad, thickness,
+			blur_px, param_a, p.order, f); },
+		[](auto const& r, frame const& f) { return r.plane(f); });
 	if (result.zero_sized) {
 		// should turn empty.
-		efpip->obj_w = efpip->obj_h = 0;
-		return FALSE; // invalidate subsequent filters.
+		fr.obj_w = fr.obj_h = 0;
+		return false; // invalidate subsequent filters.
 	}
 
 	int const displace = std::min(std::min(
-		exedit.yca_max_w - src_w, // also be aware of the maximum size.
-		exedit.yca_max_h - src_h) >> 1,
+		fr.max_w - src_w, // also be aware of the maximum size.
+		fr.max_h - src_h) >> 1,
 		arith::floor_div(distance + (den_distance - 1), den_distance)
 			+ (thickness >= 0 ? (thickness + (den_distance - 1)) / den_distance : 0)),
-		dst_w = efpip->obj_w += 2 * displace,
-		dst_h = efpip->obj_h += 2 * displace;
+		dst_w = fr.obj_w += 2 * displace,
+		dst_h = fr.obj_h += 2 * displace;
 
 	if (result.is_empty) {
 		// resized but completely transparent.
-		buff::clear_alpha(efpip->obj_edit, efpip->obj_line, 0, 0, dst_w, dst_h);
-		return TRUE;
+		buff::clear_alpha(fr.obj_edit, fr.obj_line, 0, 0, dst_w, dst_h);
+		return true;
 	}
 
 	int const diff_displace = displace - result.displace,
 		T = result.bd.T + diff_displace, B = result.bd.B + diff_displace,
 		L = std::max(result.bd.L + diff_displace, 0), R = std::min(result.bd.R + diff_displace, dst_w),
 		r = dst_w - R, in_w = R - L;
-	i16 const* const src0 = reinterpret_cast<i16*>(efpip->obj_edit)
-		+ L - diff_displace * (1 + result.stride);
-	if (tiled_image const img{ exdata->file, img_x, img_y, displace, efp, *exedit.memory_ptr }) {
+	auto const src_pl = result.plane(fr);
+	i16 const* const src0 = src_pl.at(L - diff_displace, -diff_displace);
+	size_t const src_step = src_pl.step;
+	if (tiled_image const img{ p.pattern, img_x, img_y, displace, fr.heap, fr.obj_line, fr.max_h }) {
 		// image seems to have been successfully loaded.
 		// fill with the pattern image.
-		auto paint = [&, img_stride = efpip->obj_line](i16 src_a, int px_x, int px_y) noexcept -> ExEdit::PixelYCA {
+		auto paint = [&, img_stride = fr.obj_line](i16 src_a, int px_x, int px_y) noexcept -> ExEdit::PixelYCA {
 			ExEdit::PixelYCA col = img[px_x + px_y * img_stride];
 			col.a = static_cast<i16>((col.a * src_a) >> log2_max_alpha);
 			return col;
 		};
 
+		MultiThread::chunks rows{ multi_thread, dst_h };
 		multi_thread(dst_h, [&](int thread_id, int thread_num) {
-			for (int y = thread_id; y < dst_h; y += thread_num) {
-				auto* dst = efpip->obj_temp + y * efpip->obj_line;
+			for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+				auto* dst = fr.obj_temp + y * fr.obj_line;
 				if (y < T || y >= B) {
 					for (int x = dst_w; --x >= 0; dst++) dst->a = 0;
 				}
@@ -712,9 +851,9 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 					int i_x = (img.ox + L) % img.w, i_y = (y + img.oy) % img.h;
 					auto incr_x = [&] { i_x++; if (i_x >= img.w) i_x -= img.w; };
 
-					auto* src = src0 + y * result.stride;
+					auto* src = src0 + y * src_pl.stride;
 					for (int x = L; --x >= 0; dst++) dst->a = 0;
-					for (int x = in_w; --x >= 0; dst++, src++, incr_x()) *dst = paint(*src, i_x, i_y);
+					for (int x = in_w; --x >= 0; dst++, src += src_step, incr_x()) *dst = paint(*src, i_x, i_y);
 					for (int x = r; --x >= 0; dst++) dst->a = 0;
 				}
 			}
@@ -722,28 +861,29 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 	}
 	else {
 		// fill with specified color.
-		auto const col = buff::fromRGB(exdata->color.r, exdata->color.g, exdata->color.b);
+		auto const col = buff::fromRGB(p.color.r, p.color.g, p.color.b);
 		auto paint = [&](i16 src_a) noexcept -> ExEdit::PixelYCA {
 			return { .y = col.y, .cb = col.cb, .cr = col.cr, .a = src_a };
 		};
 
+		MultiThread::chunks rows{ multi_thread, dst_h };
 		multi_thread(dst_h, [&](int thread_id, int thread_num) {
-			for (int y = thread_id; y < dst_h; y += thread_num) {
-				auto* dst = efpip->obj_temp + y * efpip->obj_line;
+			for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+				auto* dst = fr.obj_temp + y * fr.obj_line;
 				if (y < T || y >= B) {
 					for (int x = dst_w; --x >= 0; dst++) dst->a = 0;
 				}
 				else {
-					auto* src = src0 + y * result.stride;
+					auto* src = src0 + y * src_pl.stride;
 					for (int x = L; --x >= 0; dst++) dst->a = 0;
-					for (int x = in_w; --x >= 0; dst++, src++) *dst = paint(*src);
+					for (int x = in_w; --x >= 0; dst++, src += src_step) *dst = paint(*src);
 					for (int x = r; --x >= 0; dst++) dst->a = 0;
 				}
 			}
 		});
 	}
-	std::swap(efpip->obj_edit, efpip->obj_temp);
+	std::swap(fr.obj_edit, fr.obj_temp);
 
-	return TRUE;
+	return true;
 }
 
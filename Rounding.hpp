@@ -23,6 +23,7 @@ using byte = uint8_t;
 #include <exedit.hpp>
 
 #include "CircleBorder_S.hpp"
+#include "Rounding_core.hpp"
 
 
 ////////////////////////////////
@@ -34,36 +35,6 @@ namespace Filter::Rounding
 	{
 		FILTER_INFO("角丸めσ");
 
-		// trackbars.
-		constexpr const char* track_names[]
-			= { "半径", "縁の縮小", "透明度", "ぼかし", "param_a" };
-		constexpr int32_t
-			track_den[]			= {   10,   10,   10,   10,   10 },
-			track_min[]			= {    0,    0,    0,    0,    0 },
-			track_min_drag[]	= {    0,    0,    0,    0,    0 },
-			track_default[]		= {  320,    0, 1000,    0,  500 },
-			track_max_drag[]	= { 2000, 2000, 1000, 2000, 1000 },
-			track_max[]			= { 5000, 5000, 1000, 5000, 1000 };
-		namespace idx_track
-		{
-			enum id : int {
-				radius,
-				shrink,
-				transp,
-				blur,
-				param_a,
-			};
-			constexpr int count_entries = std::size(track_names);
-		};
-
-		static_assert(
-			std::size(track_names) == std::size(track_den) &&
-			std::size(track_names) == std::size(track_min) &&
-			std::size(track_names) == std::size(track_min_drag) &&
-			std::size(track_names) == std::size(track_default) &&
-			std::size(track_names) == std::size(track_max_drag) &&
-			std::size(track_names) == std::size(track_max));
-
 		// checks.
 		constexpr const char* check_names[]
 			= { "サイズも縮小", gui::algorithm_names };
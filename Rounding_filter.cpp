@@ -13,11 +13,6 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 #include <cstdint>
 #include <algorithm>
 
-#define NOMINMAX
-#define WIN32_LEAN_AND_MEAN
-using byte = uint8_t;
-#include <exedit.hpp>
-
 #include "multi_thread.hpp"
 #include "buffer_op.hpp"
 
@@ -27,7 +22,8 @@ using byte = uint8_t;
 #include "kind_sum/inf_def.hpp"
 
 #include "filter_defl.hpp"
-#include "Rounding.hpp"
+#include "incremental.hpp"
+#include "Rounding_core.hpp"
 
 using namespace Filter::Rounding;
 using namespace Calculation;
@@ -68,19 +64,22 @@ using namespace Rounding_filter::params::exp;
 ////////////////////////////////
 constexpr Filter::Common::defl_bin<den_radius, max_param_a> defl_bin{};
 constexpr Filter::Common::defl_bin2x<den_radius, max_param_a> defl_bin2x{};
-constexpr Filter::Common::defl_max<den_radius> defl_max{};
-constexpr Filter::Common::defl_max_fast<den_radius> defl_max_fast{};
-constexpr Filter::Common::defl_sum<den_radius, max_param_a> defl_sum{};
-
-static constexpr defl_base const& choose_defl(Filter::Algorithm algorithm) {
+constexpr Filter::Common::defl_max<den_radius> defl_max_12{};
+constexpr Filter::Common::defl_max<den_radius, alpha8> defl_max_8{};
+constexpr Filter::Common::defl_max_fast<den_radius> defl_max_fast_12{};
+constexpr Filter::Common::defl_max_fast<den_radius, alpha8> defl_max_fast_8{};
+constexpr Filter::Common::defl_sum<den_radius, max_param_a> defl_sum_12{};
+constexpr Filter::Common::defl_sum<den_radius, max_param_a, alpha8> defl_sum_8{};
+
+static constexpr defl_base const& choose_defl(Filter::Algorithm algorithm, bool use_alpha8) {
 	switch (algorithm) {
 		using algo = Filter::Algorithm;
 	case algo::bin: return defl_bin;
 	default:
 	case algo::bin2x: return defl_bin2x;
-	case algo::max: return defl_max;
-	case algo::max_fast: return defl_max_fast;
-	case algo::sum: return defl_sum;
+	case algo::max: if (use_alpha8) return defl_max_8; return defl_max_12;
+	case algo::max_fast: if (use_alpha8) return defl_max_fast_8; return defl_max_fast_12;
+	case algo::sum: if (use_alpha8) return defl_sum_8; return defl_sum_12;
 	}
 }
 
@@ -88,46 +87,68 @@ static constexpr defl_base const& choose_defl(Filter::Algorithm algorithm) {
 ////////////////////////////////
 // フィルタ処理のエントリポイント．
 ////////////////////////////////
-BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
+bool Filter::Rounding::process(params const& p, frame& fr)
 {
-	int const src_w = efpip->obj_w, src_h = efpip->obj_h;
-	if (src_w <= 0 || src_h <= 0) return TRUE;
+	int const src_w = fr.obj_w, src_h = fr.obj_h;
+	if (src_w <= 0 || src_h <= 0) return true;
 
 	int const
-		radius	= std::clamp(efp->track[idx_track::radius	], min_radius	, max_radius	),
-		shrink	= std::clamp(efp->track[idx_track::shrink	], min_shrink	, max_shrink	),
-		transp	= std::clamp(efp->track[idx_track::transp	], min_transp	, max_transp	),
-		blur_px	= std::clamp(efp->track[idx_track::blur		], min_blur		, max_blur		),
-		param_a	= std::clamp(efp->track[idx_track::param_a	], min_param_a	, max_param_a	);
-	bool const crop = efp->check[idx_check::crop] != check_data::unchecked;
-	auto const algorithm = reinterpret_cast<Exdata*>(efp->exdata_ptr)->algorithm;
+		radius	= std::clamp(p.radius	, min_radius	, max_radius	),
+		shrink	= std::clamp(p.shrink	, min_shrink	, max_shrink	),
+		transp	= std::clamp(p.transp	, min_transp	, max_transp	),
+		blur_px	= std::clamp(p.blur		, min_blur		, max_blur		),
+		param_a	= std::clamp(p.param_a	, min_param_a	, max_param_a	);
+	bool const crop = p.crop;
+	auto const algorithm = p.algorithm;
 
 	int const alpha = std::clamp<int>(max_alpha * (max_transp - transp) / max_transp, 0, max_alpha);
 
+	MultiThread::serial_scope const serial{ multi_thread, src_w * src_h < Filter::small_obj_area };
+
 	// "fake" radius by 0.4 so integral-radius will more likely look smooth.
 	int const lifted_radius = radius == 0 ? 0 : radius + ((den_radius >> 1) - 1);
 
 	// handle trivial cases.
-	if (!crop && alpha >= max_alpha) return TRUE; // entire effect is disabled.
-	if (lifted_radius <= 0 && shrink <= 0 && blur_px <= 0) return TRUE; // none of the values are effective.
-
-	// create the shape of alpha values onto efpip->obj_temp.
-	auto result = choose_defl(algorithm)(shrink + blur_px, lifted_radius, blur_px, param_a, crop, crop, efpip);
-	if (result.invalid) return TRUE;
+	if (!crop && alpha >= max_alpha) return true; // entire effect is disabled.
+	if (lifted_radius <= 0 && shrink <= 0 && blur_px <= 0) return true; // none of the values are effective.
+
+	// create the shape of alpha values onto fr.obj_temp.
+	auto const& defl = choose_defl(algorithm, fr.alpha8);
+	// when cropping, the final pass may place the colors already.
+	// a result restored from the caches holds only the alpha values it had then, so the colors are placed again.
+	bool combined = false;
+	// unless the result is kept for later, the margins of its plane are cleared as each row is combined.
+	bool const lazy = !Filter::Incremental::keeps(fr);
+	Bounds margins{};
+	auto result = Filter::Incremental::through('R',
+		{ static_cast<int32_t>(algorithm), shrink + blur_px, lifted_radius, blur_px, param_a, crop, fr.alpha8, fr.draft },
+		[&](frame const&) { return defl.measure_reach(shrink + blur_px, lifted_radius, blur_px); }, fr,
+		[&](frame& f) {
+			combined = false;
+			return defl(shrink + blur_px, lifted_radius, blur_px, param_a, crop, crop, f,
+				crop && &f == &fr ? &combined : nullptr, lazy ? &margins : nullptr);
+		},
+		[](auto const& r, frame const& f) { return r.plane(f); });
+	if (result.invalid) return true;
 
 	int const dst_w = src_w - 2 * result.displace, dst_h = src_h - 2 * result.displace;
 	if (crop) {
 		// final size shrinks.
-		efpip->obj_w = dst_w; efpip->obj_h = dst_h;
+		fr.obj_w = dst_w; fr.obj_h = dst_h;
 
 		if (result.is_empty) {
 			// simply clear the current image.
 			if (dst_w <= 0 || dst_h <= 0) {
-				efpip->obj_w = efpip->obj_h = 0;
-				return FALSE; // invalidate subsequent filters.
+				fr.obj_w = fr.obj_h = 0;
+				return false; // invalidate subsequent filters.
 			}
-			buff::clear_alpha(efpip->obj_edit, efpip->obj_line, 0, 0, dst_w, dst_h);
-			return TRUE;
+			buff::clear_alpha(fr.obj_edit, fr.obj_line, 0, 0, dst_w, dst_h);
+			return true;
+		}
+
+		if (combined) {
+			std::swap(fr.obj_edit, fr.obj_temp);
+			return true;
 		}
 
 		// place color onto that shape.
@@ -140,25 +161,26 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 		multi_thread(dst_h, [&](int thread_id, int thread_num) {
 			int y0 = dst_h * thread_id / thread_num,
 				y1 = dst_h * (thread_id + 1) / thread_num;
-			auto src = efpip->obj_edit + result.displace + (result.displace + y0) * efpip->obj_line,
-				dst = efpip->obj_temp + y0 * efpip->obj_line;
-			for (int y = y1 - y0; --y >= 0; src += efpip->obj_line, dst += efpip->obj_line) {
+			auto src = fr.obj_edit + result.displace + (result.displace + y0) * fr.obj_line,
+				dst = fr.obj_temp + y0 * fr.obj_line;
+			for (int y = y0; y < y1; y++, src += fr.obj_line, dst += fr.obj_line) {
+				if (lazy) buff::clear_alpha_margin(dst, dst_w, y, margins);
 				auto src_y = src, dst_y = dst;
 				for (int x = dst_w; --x >= 0; src_y++, dst_y++)
 					*dst_y = combine(dst_y->a, *src_y);
 			}
 		});
 
-		std::swap(efpip->obj_edit, efpip->obj_temp);
-		return TRUE;
+		std::swap(fr.obj_edit, fr.obj_temp);
+		return true;
 	}
 	else {
 		// final size keeps unchanged.
 
 		if (result.is_empty) {
 			// simply apply alpha value to the current image.
-			buff::mult_alpha(alpha, efpip->obj_edit, efpip->obj_line, 0, 0, src_w, src_h);
-			return TRUE;
+			buff::mult_alpha(alpha, fr.obj_edit, fr.obj_line, 0, 0, src_w, src_h);
+			return true;
 		}
 
 		// place that alpha values onto the current image.
@@ -170,14 +192,16 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 		auto decay = [&](ExEdit::PixelYCA& dst) noexcept {
 			dst.a = static_cast<i16>((dst.a * alpha) >> log2_max_alpha);
 		};
+		MultiThread::chunks rows{ multi_thread, src_h };
 		multi_thread(src_h, [&](int thread_id, int thread_num) {
-			for (int y = thread_id; y < src_h; y += thread_num) {
-				auto dst = efpip->obj_edit + y * efpip->obj_line;
+			for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+				auto dst = fr.obj_edit + y * fr.obj_line;
 				if (y < result.displace || y >= dst_h + result.displace) {
 					for (int x = src_w; --x >= 0; dst++) decay(*dst);
 				}
 				else {
-					auto src = reinterpret_cast<i16*>(efpip->obj_temp) + (y - result.displace) * result.a_stride;
+					auto src = reinterpret_cast<i16*>(fr.obj_temp) + (y - result.displace) * result.a_stride;
+					if (lazy) buff::clear_alpha_margin(src, dst_w, y - result.displace, margins);
 					for (int x = result.displace; --x >= 0; dst++) decay(*dst);
 					for (int x = dst_w; --x >= 0; dst++, src++) combine(*src, *dst);
 					for (int x = result.displace; --x >= 0; dst++) decay(*dst);
@@ -185,7 +209,7 @@ BOOL impl::func_proc(ExEdit::Filter* efp, ExEdit::FilterProcInfo* efpip)
 			}
 		});
 
-		return TRUE;
+		return true;
 	}
 }
 
@@ -14,6 +14,8 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 
 #include <cstdint>
 #include <cmath>
+#include <type_traits>
+#include <utility>
 
 
 ////////////////////////////////
@@ -29,22 +31,54 @@ namespace Calculation::arith
 		return d.quot;
 	}
 	constexpr auto abs(auto x) { return x < 0 ? -x : x; }
+	constexpr auto isqrt(auto n) {
+		// the integer square root, rounded down.
+		if (n <= 1) return n;
+		auto x = n, y = (x + 1) / 2;
+		while (y < x) x = y, y = (x + n / x) / 2;
+		return x;
+	}
 	namespace arc
 	{
-		inline size_t half(size_t size_sq, int32_t* arc)
+		// radii up to this have their own instances of the kernels,
+		// whose loops along the arcs are unrolled.
+		constexpr int max_unrolled = 16;
+
+		constexpr size_t half(size_t size_sq, int32_t* arc)
 		{
-			int sz = static_cast<int>(std::sqrt(size_sq));
+			int sz = static_cast<int>(isqrt(size_sq));
 			arc[sz] = sz;
 			for (int i = 1, K = size_sq - 1, d = 3; K >= 0; i++, K -= d, d += 2)
-				arc[sz + i] = arc[sz - i] = static_cast<int32_t>(std::sqrt(K));
+				arc[sz + i] = arc[sz - i] = static_cast<int32_t>(isqrt(K));
 
 			return sz;
 		}
-		inline size_t quarter(size_t size_sq, int32_t* arc)
+		constexpr size_t quarter(size_t size_sq, int32_t* arc)
 		{
 			for (int i = 0, K = size_sq, d = 1; K >= 0; i++, K -= d, d += 2)
-				arc[i] = static_cast<int32_t>(std::sqrt(K));
+				arc[i] = static_cast<int32_t>(isqrt(K));
 			return arc[0];
 		}
+
+		// calls f(std::integral_constant<int, N>{}) where N == size if 0 < size <= max_unrolled,
+		// or N == 0 otherwise.
+		template<int N = max_unrolled>
+		constexpr decltype(auto) dispatch(int size, auto&& f)
+		{
+			if constexpr (N <= 0) return f(std::integral_constant<int, 0>{});
+			else {
+				if (size == N) return f(std::integral_constant<int, N>{});
+				return dispatch<N - 1>(size, f);
+			}
+		}
+
+		// calls f(d) for each d from -N to N, fully unrolled.
+		template<int N>
+		constexpr void unroll(auto&& f)
+		{
+			[&]<int... I>(std::integer_sequence<int, I...>) {
+				(f(I - N), ...);
+			}(std::make_integer_sequence<int, 2 * N + 1>{});
+		}
 	}
 }
@@ -12,7 +12,9 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <algorithm>
 #include <limits>
 #include <concepts>
 #include <tuple>
@@ -29,6 +31,27 @@ namespace Calculation
 	constexpr size_t log2_max_alpha = 12;
 	constexpr i16 max_alpha = 1 << log2_max_alpha;
 
+	// precision of the alpha values on the planes that kernels keep for themselves.
+	// values on the other buffers are always in the scale of `max_alpha`.
+	template<std::integral A, int max_val>
+	struct precision {
+		using type = A;
+		constexpr static int max = max_val;
+
+		// conversions from/to the scale of `max_alpha`, assuming the value is in range.
+		constexpr static A from_alpha(int a) {
+			if constexpr (max == max_alpha) return static_cast<A>(a);
+			else return static_cast<A>((a * max + (max_alpha >> 1)) >> log2_max_alpha);
+		}
+		constexpr static i16 to_alpha(int v) {
+			if constexpr (max == max_alpha) return static_cast<i16>(v);
+			else return static_cast<i16>((v * max_alpha + (max >> 1)) / max);
+		}
+	};
+	using alpha12 = precision<i16, max_alpha>;
+	// coarser, but halves the memory for the planes; suitable for previews.
+	using alpha8 = precision<uint8_t, 255>;
+
 	struct Bounds {
 		int L, T; // inclusive.
 		int R, B; // exclusive.
@@ -49,6 +72,74 @@ namespace Calculation
 		constexpr operator std::tuple<int&, int&, int&, int&>() { return { L, T, R, B }; }
 	};
 
+	// a view to alpha values, either of a plane of their own or of the pixels of an image.
+	struct plane {
+		i16* buf; // the value at (0, 0).
+		size_t step, stride; // distances to the next pixel and row, in units of i16.
+		Bounds bd; // the region of the valid values, empty if none.
+
+		constexpr bool colored() const { return step != 1; }
+		constexpr i16* at(int x, int y) const {
+			return buf + x * static_cast<ptrdiff_t>(step) + y * static_cast<ptrdiff_t>(stride);
+		}
+		// the same values, placed at a distance of (x, y).
+		[[nodiscard]] constexpr plane move(int x, int y) const { return { at(-x, -y), step, stride, bd.move(x, y) }; }
+	};
+
+	// what kernels do to each row of their result right after writing it, while it's still in the cache.
+	// placed in the same coordinates as the bounds the kernels return.
+	struct row_sink {
+		// values subtracted from the result, clamping at zero. unused if `buf` is null.
+		plane carve{};
+		// pixels whose colors a result on the alpha channel of an image takes, clamping its alpha by theirs.
+		// `step` must be 4, and unused if `buf` is null.
+		plane colors{};
+
+		[[nodiscard]] constexpr row_sink move(int x, int y) const {
+			return {
+				carve.buf != nullptr ? carve.move(x, y) : carve,
+				colors.buf != nullptr ? colors.move(x, y) : colors,
+			};
+		}
+
+		// applies to [x0, x1) on the row `y`, where `a_buf` points to x = 0 of the row.
+		template<size_t a_step>
+		void apply(i16* a_buf, int x0, int x1, int y) const
+		{
+			if (carve.buf != nullptr) sub_row<a_step>(a_buf, x0, x1, y, carve);
+			if constexpr (a_step == 4)
+				if (colors.buf != nullptr) color_row(a_buf, x0, x1, y, colors);
+		}
+
+	private:
+		static bool clip(int& x0, int& x1, int y, Bounds const& bd)
+		{
+			if (y < bd.T || y >= bd.B) return false;
+			x0 = std::max(x0, bd.L); x1 = std::min(x1, bd.R);
+			return x0 < x1;
+		}
+		template<size_t a_step>
+		static void sub_row(i16* a_buf, int x0, int x1, int y, plane const& sub)
+		{
+			if (!clip(x0, x1, y, sub.bd)) return;
+			auto s = sub.at(x0, y);
+			a_buf += x0 * a_step;
+			for (int x = x1 - x0; --x >= 0; a_buf += a_step, s += sub.step)
+				*a_buf = std::max(*a_buf - *s, 0);
+		}
+		// the colors precede the alpha value in a pixel.
+		static void color_row(i16* a_buf, int x0, int x1, int y, plane const& src)
+		{
+			if (!clip(x0, x1, y, src.bd)) return;
+			auto s = src.at(x0, y);
+			a_buf += x0 * 4;
+			for (int x = x1 - x0; --x >= 0; a_buf += 4, s += 4) {
+				a_buf[-3] = s[-3]; a_buf[-2] = s[-2]; a_buf[-1] = s[-1];
+				a_buf[0] = std::min(a_buf[0], s[0]);
+			}
+		}
+	};
+
 	// each element in `range` is a left-closed, right-open interval.
 	// returned interval is left-closed, right-open.
 	template<std::totally_ordered T>
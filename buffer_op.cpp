@@ -11,6 +11,7 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 */
 
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
 #include <tuple>
 #include <cmath>
@@ -22,6 +23,12 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 
 using namespace Calculation;
 
+// simple per-pixel operations are worth a thread per this many pixels.
+constexpr int pixels_grain = 1 << 14;
+constexpr MultiThread::work rows_of(int h, int w) {
+	return { h, std::max(pixels_grain / std::max(w, 1), 1) };
+}
+
 
 ////////////////////////////////
 // よくあるバッファ操作の実装．
@@ -33,7 +40,7 @@ void buff::copy_alpha(ExEdit::PixelYCA const* src, size_t src_stride, int src_x,
 
 	src += src_x + src_y * src_stride;
 	dst += dst_x + dst_y * dst_stride;
-	multi_thread(src_h, [=](int thread_id, int thread_num) {
+	multi_thread(rows_of(src_h, src_w), [=](int thread_id, int thread_num) {
 		for (int y = thread_id * src_h / thread_num, y1 = (thread_id + 1) * src_h / thread_num;
 			y < y1; y++) {
 			auto src_y = src + y * src_stride;
@@ -50,7 +57,7 @@ void buff::copy_alpha(i16 const* a_src, size_t a_stride, int src_x, int src_y, i
 
 	a_src += src_x + src_y * a_stride;
 	dst += dst_x + dst_y * dst_stride;
-	multi_thread(src_h, [=](int thread_id, int thread_num) {
+	multi_thread(rows_of(src_h, src_w), [=](int thread_id, int thread_num) {
 		for (int y = thread_id * src_h / thread_num, y1 = (thread_id + 1) * src_h / thread_num;
 			y < y1; y++) {
 			auto src_y = a_src + y * a_stride;
@@ -67,7 +74,7 @@ void buff::copy_alpha(ExEdit::PixelYCA const* src, size_t src_stride, int src_x,
 
 	src += src_x + src_y * src_stride;
 	a_dst += dst_x + dst_y * a_stride;
-	multi_thread(src_h, [=](int thread_id, int thread_num) {
+	multi_thread(rows_of(src_h, src_w), [=](int thread_id, int thread_num) {
 		for (int y = thread_id * src_h / thread_num, y1 = (thread_id + 1) * src_h / thread_num;
 			y < y1; y++) {
 			auto src_y = src + y * src_stride;
@@ -82,7 +89,7 @@ void buff::clear_alpha(ExEdit::PixelYCA* dst, size_t dst_stride, int x, int y, i
 	if (w <= 0 || h <= 0) return;
 
 	dst += x + y * dst_stride;
-	multi_thread(std::min(w, h), [=](int thread_id, int thread_num) {
+	multi_thread(rows_of(h, w), [=](int thread_id, int thread_num) {
 		for (int y = h * thread_id / thread_num, y1 = h * (thread_id + 1) / thread_num;
 			y < y1; y++) {
 			auto dst_y = dst + y * dst_stride;
@@ -100,7 +107,7 @@ void buff::clear_alpha(i16* dst, size_t a_stride, int x, int y, int w, int h, bo
 		// if the stride is small enough w.r.t. the width, use memset() instead.
 		std::memset(dst, 0, sizeof(*dst) * (w + (h - 1) * a_stride));
 	else {
-		multi_thread(std::min(w, h), [=](int thread_id, int thread_num) {
+		multi_thread(rows_of(h, w), [=](int thread_id, int thread_num) {
 			for (int y = h * thread_id / thread_num, y1 = h * (thread_id + 1) / thread_num;
 				y < y1; y++)
 				std::memset(dst + y * a_stride, 0, sizeof(*dst) * w);
@@ -134,12 +141,28 @@ void buff::clear_alpha_chrome(i16* a_dst, size_t a_stride, Bounds const& outer,
 		clear_alpha(a_dst, a_stride, inner.R, t, outer.R - inner.R, h, true);
 }
 
+void buff::clear_alpha_margin(ExEdit::PixelYCA* row, int w, int y, Bounds const& inner)
+{
+	int l = w, r = w;
+	if (inner.T <= y && y < inner.B) l = std::clamp(inner.L, 0, w), r = std::clamp(inner.R, l, w);
+	for (int x = 0; x < l; x++) row[x].a = 0;
+	for (int x = r; x < w; x++) row[x].a = 0;
+}
+
+void buff::clear_alpha_margin(i16* a_row, int w, int y, Bounds const& inner)
+{
+	int l = w, r = w;
+	if (inner.T <= y && y < inner.B) l = std::clamp(inner.L, 0, w), r = std::clamp(inner.R, l, w);
+	std::memset(a_row, 0, sizeof(*a_row) * l);
+	std::memset(a_row + r, 0, sizeof(*a_row) * (w - r));
+}
+
 void buff::mult_alpha(i16 const* a_src, size_t a_stride, int src_x, int src_y, int src_w, int src_h,
 	ExEdit::PixelYCA* dst, size_t dst_stride, int dst_x, int dst_y)
 {
 	a_src += src_x + src_y * a_stride;
 	dst += dst_x + dst_y * dst_stride;
-	multi_thread(src_h, [=](int thread_id, int thread_num) {
+	multi_thread(rows_of(src_h, src_w), [=](int thread_id, int thread_num) {
 		for (int y = thread_id * src_h / thread_num, y1 = (thread_id + 1) * src_h / thread_num;
 			y < y1; y++) {
 			auto src_y = a_src + y * a_stride;
@@ -155,7 +178,7 @@ void buff::mult_alpha(i16 alpha, ExEdit::PixelYCA* dst, size_t dst_stride, int x
 	if (w <= 0 || h <= 0) return;
 
 	dst += x + y * dst_stride;
-	multi_thread(h, [=](int thread_id, int thread_num) {
+	multi_thread(rows_of(h, w), [=](int thread_id, int thread_num) {
 		for (int y = thread_id * h / thread_num, y1 = (thread_id + 1) * h / thread_num;
 			y < y1; y++) {
 			auto dst_y = dst + y * dst_stride;
@@ -170,7 +193,7 @@ void buff::mult_alpha(i16 alpha, i16* a_dst, size_t a_stride, int x, int y, int
 	if (w <= 0 || h <= 0) return;
 
 	a_dst += x + y * a_stride;
-	multi_thread(h, [=](int thread_id, int thread_num) {
+	multi_thread(rows_of(h, w), [=](int thread_id, int thread_num) {
 		for (int y = thread_id * h / thread_num, y1 = (thread_id + 1) * h / thread_num;
 			y < y1; y++) {
 			auto dst_y = a_dst + y * a_stride;
@@ -185,7 +208,7 @@ void buff::binarize(ExEdit::PixelYCA const* src, size_t src_stride, int src_x, i
 {
 	if (src_w <= 0 || src_h <= 0) return;
 
-	multi_thread(src_h, [=](int thread_id, int thread_num) {
+	multi_thread(rows_of(src_h, src_w), [=](int thread_id, int thread_num) {
 		for (int y = src_h * thread_id / thread_num, y1 = src_h * (thread_id + 1) / thread_num;
 			y < y1; y++) {
 			auto src1 = src + src_x + (src_y + y) * src_stride;
@@ -201,7 +224,7 @@ void buff::binarize(ExEdit::PixelYCA const* src, size_t src_stride, int src_x, i
 {
 	if (src_w <= 0 || src_h <= 0) return;
 
-	multi_thread(src_h, [=](int thread_id, int thread_num) {
+	multi_thread(rows_of(src_h, src_w), [=](int thread_id, int thread_num) {
 		for (int y = src_h * thread_id / thread_num, y1 = src_h * (thread_id + 1) / thread_num;
 			y < y1; y++) {
 			auto src1 = src + src_x + (src_y + y) * src_stride;
@@ -217,7 +240,7 @@ void buff::binarize(i16 const* a_src, size_t a_stride, int src_x, int src_y, int
 {
 	if (src_w <= 0 || src_h <= 0) return;
 
-	multi_thread(src_h, [=](int thread_id, int thread_num) {
+	multi_thread(rows_of(src_h, src_w), [=](int thread_id, int thread_num) {
 		for (int y = src_h * thread_id / thread_num, y1 = src_h * (thread_id + 1) / thread_num;
 			y < y1; y++) {
 			auto src1 = a_src + src_x + (src_y + y) * a_stride;
@@ -228,6 +251,65 @@ void buff::binarize(i16 const* a_src, size_t a_stride, int src_x, int src_y, int
 	});
 }
 
+bool buff::is_opaque(ExEdit::PixelYCA const* src, size_t src_stride, int x, int y, int w, int h)
+{
+	if (w <= 0 || h <= 0) return false;
+
+	src += x + y * src_stride;
+	auto const opaque = multi_thread(rows_of(h, w), [=](int thread_id, int thread_num) {
+		for (int y = h * thread_id / thread_num, y1 = h * (thread_id + 1) / thread_num;
+			y < y1; y++) {
+			auto src_y = src + y * src_stride;
+			for (int x = w; --x >= 0; src_y++) {
+				if (src_y->a < max_alpha) return 0;
+			}
+		}
+		return 1;
+	});
+	return std::ranges::all_of(opaque, [](int o) { return o != 0; });
+}
+
+template<size_t a_step>
+static inline void stretch_alpha_core(i16* a_dst, size_t src_stride, int src_w, int src_h,
+	size_t dst_stride, int dst_w, int dst_h, i16* heap)
+{
+	if (src_w <= 0 || src_h <= 0) return;
+
+	// take a compact copy of the source first, as the destination overlaps it.
+	for (int y = 0; y < src_h; y++) {
+		auto src_y = a_dst + y * src_stride;
+		auto tmp_y = heap + y * src_w;
+		for (int x = src_w; --x >= 0; src_y += a_step, tmp_y++) *tmp_y = *src_y;
+	}
+
+	int const cx = src_w >> 1, cy = src_h >> 1,
+		ex = dst_w - src_w, ey = dst_h - src_h;
+	MultiThread::chunks rows{ multi_thread, dst_h };
+	multi_thread(rows_of(dst_h, dst_w), [=, &rows](int thread_id, int thread_num) {
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+			auto tmp_y = heap + (y < cy ? y : y <= cy + ey ? cy : y - ey) * src_w;
+			auto dst_y = a_dst + y * dst_stride;
+			for (int x = 0; x < cx; x++, dst_y += a_step) *dst_y = tmp_y[x];
+			for (int x = ex + 1; --x >= 0; dst_y += a_step) *dst_y = tmp_y[cx];
+			for (int x = cx + 1; x < src_w; x++, dst_y += a_step) *dst_y = tmp_y[x];
+		}
+	});
+}
+
+void buff::stretch_alpha(ExEdit::PixelYCA* dst, size_t dst_stride,
+	int src_w, int src_h, int dst_w, int dst_h, void* heap)
+{
+	stretch_alpha_core<4>(&dst->a, 4 * dst_stride, src_w, src_h, 4 * dst_stride, dst_w, dst_h,
+		reinterpret_cast<i16*>(heap));
+}
+
+void buff::stretch_alpha(i16* a_dst, size_t src_stride, int src_w, int src_h,
+	size_t dst_stride, int dst_w, int dst_h, void* heap)
+{
+	stretch_alpha_core<1>(a_dst, src_stride, src_w, src_h, dst_stride, dst_w, dst_h,
+		reinterpret_cast<i16*>(heap));
+}
+
 
 template<size_t a_step>
 static inline void blur_alpha_core(i16* a_dst, size_t a_stride, int w, int h, int blur_px, uint32_t* sums)
@@ -36,6 +36,9 @@ namespace Calculation::buff
 
 	void clear_alpha_chrome(ExEdit::PixelYCA* dst, size_t dst_stride, Bounds const& outer, Bounds const& inner);
 	void clear_alpha_chrome(i16* a_dst, size_t a_stride, Bounds const& outer, Bounds const& inner);
+	// the same as clear_alpha_chrome() on the row `y` of `w` pixels, for the loops visiting each row anyway.
+	void clear_alpha_margin(ExEdit::PixelYCA* row, int w, int y, Bounds const& inner);
+	void clear_alpha_margin(i16* a_row, int w, int y, Bounds const& inner);
 
 	void mult_alpha(i16 const* a_src, size_t a_stride, int src_x, int src_y, int src_w, int src_h,
 		ExEdit::PixelYCA* dst, size_t dst_stride, int dst_x, int dst_y);
@@ -49,6 +52,15 @@ namespace Calculation::buff
 	void binarize(i16 const* a_src, size_t a_stride, int src_x, int src_y, int src_w, int src_h,
 		ExEdit::PixelYCA* dst, size_t dst_stride, int dst_x, int dst_y, i16 thresh);
 
+	bool is_opaque(ExEdit::PixelYCA const* src, size_t src_stride, int x, int y, int w, int h);
+
+	// stretches the alpha values of `src_w` x `src_h` at the top-left into `dst_w` x `dst_h`,
+	// by repeating the center row and column.
+	void stretch_alpha(ExEdit::PixelYCA* dst, size_t dst_stride,
+		int src_w, int src_h, int dst_w, int dst_h, void* heap);
+	void stretch_alpha(i16* a_dst, size_t src_stride, int src_w, int src_h,
+		size_t dst_stride, int dst_w, int dst_h, void* heap);
+
 	constexpr size_t log2_den_blur_px = 12,
 		den_blur_px = 1 << log2_den_blur_px;
 	// returns the inflation size of each side.
@@ -73,11 +85,11 @@ namespace Calculation::buff
 		};
 	}
 
-	constexpr ExEdit::PixelYCA* alpha_to_pixel(i16* a_ptr) {
+	inline ExEdit::PixelYCA* alpha_to_pixel(i16* a_ptr) {
 		constexpr auto ofs = offsetof(ExEdit::PixelYCA, a) / sizeof(i16);
 		return (ExEdit::PixelYCA*)(a_ptr - ofs);
 	}
-	constexpr ExEdit::PixelYCA const* alpha_to_pixel(i16 const* a_ptr) {
+	inline ExEdit::PixelYCA const* alpha_to_pixel(i16 const* a_ptr) {
 		constexpr auto ofs = offsetof(ExEdit::PixelYCA, a) / sizeof(i16);
 		return (ExEdit::PixelYCA const*)(a_ptr - ofs);
 	}
@@ -0,0 +1,474 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <map>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../multi_thread.hpp"
+#include "../result_cache.hpp"
+#include "../incremental.hpp"
+#include "../sdf.hpp"
+#include "../Border_core.hpp"
+#include "../Rounding_core.hpp"
+#include "../Outline_core.hpp"
+#include "pnm.hpp"
+#include "pipeline.hpp"
+
+
+////////////////////////////////
+// コマンドライン引数．
+////////////////////////////////
+static constexpr char const usage[] =
+R"(usage: circleborder_cli <border|rounding|outline> [--name=value ...] [input [output]]
+
+reads PAM (P7) or binary PNM (P5, P6) images from `input` (default: stdin),
+and writes the results as PAM to `output` (default: stdout).
+several images concatenated in the input are processed as a stream,
+reading and writing in parallel with the processing.
+  --raw=WxH  reads and writes raw frames of ExEdit's YCA pixels instead;
+             the results are centered on the canvas of the size told on stderr.
+  --batch=N  processes up to N frames at once, each on a thread of its own
+             (default: twice the threads). 1 for the least latency.
+  --cache=DIR  keeps the results of the shape in DIR, to skip recomputing them
+               for the same images and parameters, up to --cache_mb=N (default: 1024).
+  --incremental=0|1  recomputes only around the part changed from the previous frame
+                     of the same size, processing the frames one by one.
+  --sdf=0|1  derives the shapes of the algorithm `bin` from a distance field of the image.
+  --alpha8=0|1  keeps the alpha in 8 bits within the algorithms `sum`, `max` and `max_fast`,
+                coarser but lighter, e.g. for previews.
+  --draft=1|2|4  computes the shapes of large radii by the algorithms `sum`, `max` and `max_fast`
+                 on the image scaled down by the factor; coarser but much faster, e.g. for previews.
+
+common options:
+  --algorithm=bin|bin2x|sum|max|max_fast  (default: bin2x)
+  --param_a=N     --blur=N     --threads=N  (0 for all the cores)
+border:
+  --size=N  --neg_size=N  --transp=N  --f_transp=N
+  --color=RRGGBB  --pattern=FILE  --img_x=N  --img_y=N
+rounding:
+  --radius=N  --shrink=N  --transp=N  --crop=0|1
+outline:
+  --distance=N  --thickness=N  --pos_rad=N  --neg_rad=N
+  --order=faster|infl_once|defl_once
+  --color=RRGGBB  --pattern=FILE  --img_x=N  --img_y=N
+values are in the same units as the trackbars, fractions allowed.
+)";
+
+struct options {
+	std::string filter;
+	std::map<std::string, std::string> values;
+	std::vector<std::string> files;
+
+	// pops the value of the option, if specified.
+	std::optional<std::string> take(std::string const& name)
+	{
+		auto it = values.find(name);
+		if (it == values.end()) return std::nullopt;
+		auto ret = std::move(it->second);
+		values.erase(it);
+		return ret;
+	}
+};
+
+static options parse_args(std::span<char*> args)
+{
+	options opt{};
+	for (std::string arg : args) {
+		if (arg.starts_with("--")) {
+			auto pos = arg.find('=');
+			if (pos == std::string::npos)
+				throw std::invalid_argument{ "missing value: " + arg };
+			opt.values[arg.substr(2, pos - 2)] = arg.substr(pos + 1);
+		}
+		else if (opt.filter.empty()) opt.filter = arg;
+		else opt.files.push_back(arg);
+	}
+	if (opt.filter.empty() || opt.files.size() > 2)
+		throw std::invalid_argument{ "wrong number of arguments." };
+	return opt;
+}
+
+// trackbar values specified by the options.
+template<class P>
+struct track_opt {
+	char const* name;
+	int idx;
+	int P::* member;
+};
+template<class P, size_t N>
+static void take_tracks(P& p, track_opt<P> const(&tracks)[N],
+	int32_t const* den, int32_t const* def, options& opt)
+{
+	for (auto const& t : tracks) {
+		if (auto v = opt.take(t.name))
+			p.*t.member = static_cast<int>(std::lround(std::stod(*v) * den[t.idx]));
+		else p.*t.member = def[t.idx];
+	}
+}
+
+static Filter::Algorithm take_algorithm(options& opt)
+{
+	using algo = Filter::Algorithm;
+	auto v = opt.take("algorithm");
+	if (!v || *v == "bin2x") return algo::bin2x;
+	if (*v == "bin") return algo::bin;
+	if (*v == "sum") return algo::sum;
+	if (*v == "max") return algo::max;
+	if (*v == "max_fast") return algo::max_fast;
+	throw std::invalid_argument{ "unknown algorithm: " + *v };
+}
+
+template<class Color>
+static Color take_color(options& opt, uint32_t def)
+{
+	uint32_t c = def;
+	if (auto v = opt.take("color")) {
+		size_t pos;
+		c = std::stoul(*v, &pos, 16);
+		if (pos != v->size() || v->size() != 6)
+			throw std::invalid_argument{ "wrong color: " + *v };
+	}
+	return { static_cast<uint8_t>(c >> 16), static_cast<uint8_t>(c >> 8), static_cast<uint8_t>(c) };
+}
+
+static tiled_image::loader take_pattern(options& opt)
+{
+	auto v = opt.take("pattern");
+	if (!v) return {};
+
+	auto img = std::make_shared<pnm::image>();
+	auto fp = std::fopen(v->c_str(), "rb");
+	if (fp == nullptr) throw std::runtime_error{ "cannot open: " + *v };
+	bool const loaded = [&] {
+		try { return pnm::read(fp, *img); }
+		catch (...) { std::fclose(fp); throw; }
+	}();
+	std::fclose(fp);
+	if (!loaded) throw std::runtime_error{ "no image in: " + *v };
+
+	return [img](ExEdit::PixelYCA* buffer, int stride, int max_h, int& w, int& h) {
+		// crop to the capacity of the buffer, as ExEdit does.
+		w = std::min(img->w, stride);
+		h = std::min(img->h, max_h);
+		if (w <= 0 || h <= 0) return false;
+
+		pnm::image cropped{ .w = w, .h = h };
+		cropped.rgba.resize(4 * w * h);
+		for (int y = 0; y < h; y++)
+			std::copy_n(&img->rgba[4 * y * img->w], 4 * w, &cropped.rgba[4 * y * w]);
+		pnm::to_yca(cropped, buffer, stride);
+		return true;
+	};
+}
+
+
+////////////////////////////////
+// フィルタの構成．
+////////////////////////////////
+// applies the filter to the frame, which has `margin` pixels around the image.
+struct filter_job {
+	int margin;
+	std::function<bool(Filter::frame&)> process;
+};
+
+static filter_job make_border(options& opt)
+{
+	using namespace Filter::Border;
+	using namespace impl;
+	static constexpr track_opt<params> tracks[] = {
+		{ "size",		idx_track::size,		&params::size		},
+		{ "neg_size",	idx_track::neg_size,	&params::neg_size	},
+		{ "transp",		idx_track::transp,		&params::transp		},
+		{ "f_transp",	idx_track::f_transp,	&params::f_transp	},
+		{ "blur",		idx_track::blur,		&params::blur		},
+		{ "param_a",	idx_track::param_a,		&params::param_a	},
+		{ "img_x",		idx_track::img_x,		&params::img_x		},
+		{ "img_y",		idx_track::img_y,		&params::img_y		},
+	};
+
+	params p{};
+	take_tracks(p, tracks, track_den, track_default, opt);
+	p.algorithm = take_algorithm(opt);
+	p.color = take_color<decltype(p.color)>(opt, 0x000000);
+	p.pattern = take_pattern(opt);
+
+	int const margin = (std::abs(p.size) + p.neg_size + p.blur) / track_den[idx_track::size] + 8;
+	return { margin, [p](Filter::frame& fr) { return process(p, fr); } };
+}
+
+static filter_job make_rounding(options& opt)
+{
+	using namespace Filter::Rounding;
+	using namespace impl;
+	static constexpr track_opt<params> tracks[] = {
+		{ "radius",		idx_track::radius,		&params::radius		},
+		{ "shrink",		idx_track::shrink,		&params::shrink		},
+		{ "transp",		idx_track::transp,		&params::transp		},
+		{ "blur",		idx_track::blur,		&params::blur		},
+		{ "param_a",	idx_track::param_a,		&params::param_a	},
+	};
+
+	params p{};
+	take_tracks(p, tracks, track_den, track_default, opt);
+	p.algorithm = take_algorithm(opt);
+	p.crop = opt.take("crop").value_or("0") != "0";
+
+	return { 8, [p](Filter::frame& fr) { return process(p, fr); } };
+}
+
+static filter_job make_outline(options& opt)
+{
+	using namespace Filter::Outline;
+	using namespace impl;
+	static constexpr track_opt<params> tracks[] = {
+		{ "distance",	idx_track::distance,	&params::distance	},
+		{ "thickness",	idx_track::thickness,	&params::thickness	},
+		{ "pos_rad",	idx_track::pos_rad,		&params::pos_rad	},
+		{ "neg_rad",	idx_track::neg_rad,		&params::neg_rad	},
+		{ "blur",		idx_track::blur,		&params::blur		},
+		{ "param_a",	idx_track::param_a,		&params::param_a	},
+		{ "img_x",		idx_track::img_x,		&params::img_x		},
+		{ "img_y",		idx_track::img_y,		&params::img_y		},
+	};
+
+	params p{};
+	take_tracks(p, tracks, track_den, track_default, opt);
+	p.algorithm = take_algorithm(opt);
+	p.order = [&] {
+		auto v = opt.take("order");
+		if (!v || *v == "faster") return FilterOrder::faster;
+		if (*v == "infl_once") return FilterOrder::infl_once;
+		if (*v == "defl_once") return FilterOrder::defl_once;
+		throw std::invalid_argument{ "unknown order: " + *v };
+	}();
+	p.color = take_color<decltype(p.color)>(opt, 0xffffff);
+	p.pattern = take_pattern(opt);
+
+	int const margin = (std::abs(p.distance) + std::abs(p.thickness)
+		+ p.pos_rad + p.neg_rad + p.blur) / track_den[idx_track::distance] + 8;
+	return { margin, [p](Filter::frame& fr) { return process(p, fr); } };
+}
+
+
+////////////////////////////////
+// ストリームの入出力．
+////////////////////////////////
+// a buffer of pixels for a frame, growing only if a larger frame comes.
+// ExEdit places these buffers within a larger block of memory,
+// and some kernels touch a few rows above the image,
+// such as the rows just above the source, or the margins shifted by rounding the sizes.
+struct frame_buffer {
+	std::vector<ExEdit::PixelYCA> data;
+
+	ExEdit::PixelYCA* fit(Filter::frame const& fr)
+	{
+		size_t const guard = 4 * fr.obj_line + 8,
+			len = Filter::frame::heap_size(fr.max_w, fr.max_h) / sizeof(ExEdit::PixelYCA) + guard;
+		if (data.size() < len) data.resize(len);
+		return data.data() + guard;
+	}
+};
+
+// a frame passing through the stages, whose buffers are reused for the subsequent frames.
+struct frame_slot {
+	pnm::image img;
+	frame_buffer edit, temp, heap;
+	Filter::frame fr;
+	bool valid;
+
+	// lays out the frame for an image of `w` x `h` with `margin` pixels around.
+	void prepare(int w, int h, int margin)
+	{
+		int const max_w = w + 2 * margin, max_h = h + 2 * margin;
+		fr = {
+			.obj_w = w, .obj_h = h, .obj_line = max_w + 8,
+			.max_w = max_w, .max_h = max_h,
+		};
+		fr.obj_edit = edit.fit(fr);
+		fr.obj_temp = temp.fit(fr);
+		fr.heap = heap.fit(fr);
+	}
+};
+
+// frames processed together, each on a thread of its own.
+struct frame_group {
+	std::vector<frame_slot> slots;
+	int count;
+};
+
+// raw frames are arrays of ExEdit::PixelYCA in the native byte order, without headers.
+struct raw_size { int w, h; };
+static std::optional<raw_size> take_raw(options& opt)
+{
+	auto v = opt.take("raw");
+	if (!v) return std::nullopt;
+	raw_size sz{};
+	if (std::sscanf(v->c_str(), "%dx%d", &sz.w, &sz.h) != 2 || sz.w <= 0 || sz.h <= 0)
+		throw std::invalid_argument{ "wrong size: " + *v };
+	return sz;
+}
+
+static bool read_raw(std::FILE* fp, Filter::frame& fr)
+{
+	for (int y = 0; y < fr.obj_h; y++) {
+		size_t const got = std::fread(fr.obj_edit + y * fr.obj_line, sizeof(ExEdit::PixelYCA), fr.obj_w, fp);
+		if (got == 0 && y == 0 && std::feof(fp)) return false;
+		if (got != static_cast<size_t>(fr.obj_w))
+			throw std::runtime_error{ "unexpected end of the raw frame." };
+	}
+	return true;
+}
+
+// writes the result centered on the canvas of `w` x `h`, cropping if necessary.
+static void write_raw(std::FILE* fp, Filter::frame const& fr, bool valid, int w, int h,
+	std::vector<ExEdit::PixelYCA>& row)
+{
+	row.resize(w);
+	int const obj_w = valid ? fr.obj_w : 0, obj_h = valid ? fr.obj_h : 0,
+		dx = (w - obj_w) / 2, dy = (h - obj_h) / 2,
+		x0 = std::max(dx, 0), x1 = std::min(dx + obj_w, w);
+	for (int y = 0; y < h; y++) {
+		std::fill(row.begin(), row.end(), ExEdit::PixelYCA{});
+		if (y - dy >= 0 && y - dy < obj_h && x0 < x1)
+			std::copy_n(fr.obj_edit + (x0 - dx) + (y - dy) * fr.obj_line, x1 - x0, &row[x0]);
+		if (std::fwrite(row.data(), sizeof(ExEdit::PixelYCA), w, fp) != static_cast<size_t>(w))
+			throw std::runtime_error{ "failed to write." };
+	}
+}
+
+
+////////////////////////////////
+// エントリポイント．
+////////////////////////////////
+int main(int argc, char* argv[])
+{
+	std::FILE* in = stdin, * out = stdout;
+	try {
+		auto opt = parse_args({ argv + 1, argv + argc });
+
+		filter_job job;
+		if (opt.filter == "border") job = make_border(opt);
+		else if (opt.filter == "rounding") job = make_rounding(opt);
+		else if (opt.filter == "outline") job = make_outline(opt);
+		else throw std::invalid_argument{ "unknown filter: " + opt.filter };
+
+		auto const raw = take_raw(opt);
+		multi_thread.init_standalone(std::stoi(opt.take("threads").value_or("0")));
+		int const batch = std::stoi(opt.take("batch").value_or(std::to_string(2 * multi_thread.num_threads())));
+		if (batch <= 0) throw std::invalid_argument{ "wrong batch: " + std::to_string(batch) };
+		uint64_t const cache_mb = std::stoull(opt.take("cache_mb").value_or("1024"));
+		if (auto const dir = opt.take("cache")) {
+			if (!Filter::Cache::setup(*dir, cache_mb << 20))
+				throw std::runtime_error{ "cannot use the cache: " + *dir };
+		}
+		bool const incremental = std::stoi(opt.take("incremental").value_or("0")) != 0;
+		bool const sdf = std::stoi(opt.take("sdf").value_or("0")) != 0;
+		bool const alpha8 = std::stoi(opt.take("alpha8").value_or("0")) != 0;
+		int const draft = std::stoi(opt.take("draft").value_or("1"));
+		if (draft != 1 && draft != 2 && draft != 4)
+			throw std::invalid_argument{ "wrong draft: " + std::to_string(draft) };
+		if (!opt.values.empty())
+			throw std::invalid_argument{ "unknown option: --" + opt.values.begin()->first };
+
+		if (opt.files.size() > 0 && opt.files[0] != "-") {
+			in = std::fopen(opt.files[0].c_str(), "rb");
+			if (in == nullptr) throw std::runtime_error{ "cannot open: " + opt.files[0] };
+		}
+		if (opt.files.size() > 1 && opt.files[1] != "-") {
+			out = std::fopen(opt.files[1].c_str(), "wb");
+			if (out == nullptr) throw std::runtime_error{ "cannot open: " + opt.files[1] };
+		}
+
+		// raw frames come out on a canvas of the fixed size.
+		int const canvas_w = raw ? raw->w + 2 * job.margin : 0,
+			canvas_h = raw ? raw->h + 2 * job.margin : 0;
+		if (raw) std::fprintf(stderr, "output: %dx%d\n", canvas_w, canvas_h);
+
+		// frames are read in groups up to `batch`, to share the threads among them.
+		// a large frame closes the group, as it splits across the threads anyway.
+		auto const read_one = [&](frame_slot& s) {
+			if (raw) {
+				s.prepare(raw->w, raw->h, job.margin);
+				return read_raw(in, s.fr);
+			}
+			if (!pnm::read(in, s.img)) return false;
+			s.prepare(s.img.w, s.img.h, job.margin);
+			pnm::to_yca(s.img, s.fr.obj_edit, s.fr.obj_line);
+			return true;
+		};
+
+		// one group for each stage, and one more to absorb the jitter.
+		frame_group groups[4]{};
+		for (auto& g : groups) g.slots.resize(batch);
+		Filter::Incremental::history history{};
+		std::vector<ExEdit::PixelYCA> row{};
+		pipeline::run(std::span<frame_group>{ groups },
+			[&](frame_group& g) {
+				for (g.count = 0; g.count < batch && read_one(g.slots[g.count]);)
+					if (auto const& fr = g.slots[g.count++].fr;
+						fr.obj_w * fr.obj_h >= Filter::batch_split_area) break;
+				return g.count > 0;
+			},
+			[&](frame_group& g) {
+				auto const process = [&](int i) {
+					// reused by the frames processed on this thread in turn.
+					thread_local Filter::Sdf::field field{};
+					auto& s = g.slots[i];
+					if (sdf) s.fr.sdf = &field;
+					s.fr.alpha8 = alpha8;
+					s.fr.draft = draft;
+					s.valid = job.process(s.fr) && s.fr.obj_w > 0 && s.fr.obj_h > 0;
+				};
+				if (incremental) {
+					// each frame depends on the previous one.
+					for (int i = 0; i < g.count; i++) {
+						g.slots[i].fr.history = &history;
+						process(i);
+					}
+				}
+				else multi_thread.batch(g.count,
+					[&](int i) { return g.slots[i].fr.obj_w * g.slots[i].fr.obj_h; },
+					Filter::batch_split_area, process);
+			},
+			[&](frame_group& g) {
+				for (auto& s : std::span{ g.slots }.first(g.count)) {
+					if (raw) write_raw(out, s.fr, s.valid, canvas_w, canvas_h, row);
+					else {
+						if (s.valid) pnm::from_yca(s.fr.obj_edit, s.fr.obj_line, s.fr.obj_w, s.fr.obj_h, s.img);
+						else { s.img.w = s.img.h = 0; s.img.rgba.clear(); }
+						pnm::write(out, s.img);
+					}
+				}
+				// let the consumer of the stream start on these frames.
+				if (std::fflush(out) != 0) throw std::runtime_error{ "failed to write." };
+			});
+	}
+	catch (std::invalid_argument const& e) {
+		std::fprintf(stderr, "%s\n%s", e.what(), usage);
+		return 2;
+	}
+	catch (std::exception const& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,119 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+
+////////////////////////////////
+// 読み込み・処理・書き出しの並行化．
+////////////////////////////////
+namespace pipeline
+{
+	// a bounded FIFO handing items from one stage to the next.
+	template<class T>
+	class channel {
+		std::mutex mtx;
+		std::condition_variable cv;
+		std::vector<T> ring;
+		size_t head = 0, count = 0;
+		bool closed = false;
+
+	public:
+		explicit channel(size_t capacity) : ring(capacity) {}
+
+		// waits for a room. items pushed after closing are dropped.
+		void push(T item)
+		{
+			std::unique_lock lock{ mtx };
+			cv.wait(lock, [&] { return closed || count < ring.size(); });
+			if (closed) return;
+			ring[(head + count++) % ring.size()] = std::move(item);
+			cv.notify_all();
+		}
+		// waits for an item. returns false once closed and drained.
+		bool pop(T& item)
+		{
+			std::unique_lock lock{ mtx };
+			cv.wait(lock, [&] { return closed || count > 0; });
+			if (count == 0) return false;
+			item = std::move(ring[head]);
+			head = (head + 1) % ring.size(); count--;
+			cv.notify_all();
+			return true;
+		}
+		// `discard` drops the pending items as well, for aborting.
+		void close(bool discard = false)
+		{
+			std::lock_guard lock{ mtx };
+			closed = true;
+			if (discard) count = 0;
+			cv.notify_all();
+		}
+	};
+
+	// runs `read`, `process` and `write` over the stream in three stages,
+	// so reading the next frame and writing the previous overlap processing the current.
+	// the frames circulate among `slots`, which bounds the memory in use.
+	// `process` runs on the calling thread; `read` returns false at the end of the stream.
+	// the first exception thrown by any stage stops the others, and is rethrown.
+	template<class Slot>
+	void run(std::span<Slot> slots, auto&& read, auto&& process, auto&& write)
+	{
+		size_t const n = slots.size();
+		channel<Slot*> vacant{ n }, loaded{ n }, done{ n };
+		for (auto& s : slots) vacant.push(&s);
+
+		std::exception_ptr errors[3]{};
+		auto abort = [&](std::exception_ptr& err) {
+			err = std::current_exception();
+			vacant.close(true); loaded.close(true); done.close(true);
+		};
+
+		std::thread reader{ [&] {
+			try {
+				for (Slot* s; vacant.pop(s) && read(*s);) loaded.push(s);
+			}
+			catch (...) { abort(errors[0]); }
+			loaded.close();
+		} };
+		std::thread writer{ [&] {
+			try {
+				for (Slot* s; done.pop(s);) {
+					write(*s);
+					vacant.push(s);
+				}
+			}
+			catch (...) { abort(errors[2]); }
+		} };
+
+		try {
+			for (Slot* s; loaded.pop(s);) {
+				process(*s);
+				done.push(s);
+			}
+		}
+		catch (...) { abort(errors[1]); }
+		done.close();
+
+		reader.join(); writer.join();
+		for (auto& err : errors)
+			if (err) std::rethrow_exception(err);
+	}
+}
@@ -0,0 +1,183 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../buffer_op.hpp"
+#include "pnm.hpp"
+
+using namespace Calculation;
+
+
+////////////////////////////////
+// ヘッダの読み取り．
+////////////////////////////////
+namespace
+{
+	[[noreturn]] void fail(char const* what) {
+		throw std::runtime_error{ what };
+	}
+
+	// skips whitespaces and comments, then reads a token.
+	std::string token(std::FILE* fp)
+	{
+		int c;
+		while ((c = std::fgetc(fp)) != EOF) {
+			if (c == '#') while ((c = std::fgetc(fp)) != EOF && c != '\n');
+			else if (!std::isspace(c)) break;
+		}
+		std::string ret;
+		for (; c != EOF && !std::isspace(c); c = std::fgetc(fp)) ret += static_cast<char>(c);
+		if (c != EOF) std::ungetc(c, fp);
+		return ret;
+	}
+	int number(std::FILE* fp)
+	{
+		auto const tok = token(fp);
+		if (tok.empty() || !std::all_of(tok.begin(), tok.end(), [](char c) { return std::isdigit(c); }))
+			fail("invalid number in the header.");
+		return std::stoi(tok);
+	}
+	// consumes the rest of the line.
+	void end_of_line(std::FILE* fp)
+	{
+		for (int c; (c = std::fgetc(fp)) != EOF && c != '\n';);
+	}
+
+	struct header {
+		int w = 0, h = 0, depth = 0, maxval = 0;
+	};
+	header read_pam_header(std::FILE* fp)
+	{
+		header hd{};
+		while (true) {
+			auto const key = token(fp);
+			if (key.empty()) fail("unexpected end of the PAM header.");
+			if (key == "ENDHDR") { end_of_line(fp); break; }
+			else if (key == "WIDTH") hd.w = number(fp);
+			else if (key == "HEIGHT") hd.h = number(fp);
+			else if (key == "DEPTH") hd.depth = number(fp);
+			else if (key == "MAXVAL") hd.maxval = number(fp);
+			else end_of_line(fp); // TUPLTYPE and others; the depth tells enough.
+		}
+		if (hd.depth < 1 || hd.depth > 4) fail("unsupported PAM depth.");
+		return hd;
+	}
+	header read_pnm_header(std::FILE* fp, int depth)
+	{
+		header hd{ .depth = depth };
+		hd.w = number(fp);
+		hd.h = number(fp);
+		hd.maxval = number(fp);
+		std::fgetc(fp); // a single whitespace before the raster.
+		return hd;
+	}
+}
+
+
+////////////////////////////////
+// 読み書き．
+////////////////////////////////
+bool pnm::read(std::FILE* fp, image& img)
+{
+	auto const magic = token(fp);
+	if (magic.empty()) return false;
+
+	header hd;
+	if (magic == "P7") hd = read_pam_header(fp);
+	else if (magic == "P6") hd = read_pnm_header(fp, 3);
+	else if (magic == "P5") hd = read_pnm_header(fp, 1);
+	else fail("not a PAM/PNM image.");
+	if (hd.w <= 0 || hd.h <= 0) fail("invalid image size.");
+	if (hd.maxval <= 0 || hd.maxval > 65535) fail("invalid maxval.");
+
+	// read the raster.
+	int const bytes = hd.maxval < 256 ? 1 : 2;
+	size_t const count = size_t(hd.w) * hd.h * hd.depth;
+	// kept across the calls, so a stream of frames doesn't allocate for each.
+	thread_local std::vector<uint8_t> raw;
+	raw.resize(count * bytes);
+	if (std::fread(raw.data(), 1, raw.size(), fp) != raw.size())
+		fail("unexpected end of the raster.");
+
+	// normalize to 8-bit RGBA.
+	auto sample = [&, m = hd.maxval](size_t i) -> uint8_t {
+		int v = bytes == 1 ? raw[i] : (raw[2 * i] << 8) | raw[2 * i + 1];
+		return static_cast<uint8_t>((std::min(v, m) * 255 + (m >> 1)) / m);
+	};
+	img.w = hd.w; img.h = hd.h;
+	img.rgba.resize(size_t(hd.w) * hd.h * 4);
+	auto* dst = img.rgba.data();
+	for (size_t i = 0; i < count; i += hd.depth, dst += 4) {
+		switch (hd.depth) {
+		case 1: dst[0] = dst[1] = dst[2] = sample(i); dst[3] = 255; break;
+		case 2: dst[0] = dst[1] = dst[2] = sample(i); dst[3] = sample(i + 1); break;
+		case 3: dst[0] = sample(i); dst[1] = sample(i + 1); dst[2] = sample(i + 2); dst[3] = 255; break;
+		case 4: dst[0] = sample(i); dst[1] = sample(i + 1); dst[2] = sample(i + 2); dst[3] = sample(i + 3); break;
+		}
+	}
+	return true;
+}
+
+void pnm::write(std::FILE* fp, image const& img)
+{
+	std::fprintf(fp, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", img.w, img.h);
+	std::fwrite(img.rgba.data(), 1, img.rgba.size(), fp);
+}
+
+
+////////////////////////////////
+// 色空間の変換．
+////////////////////////////////
+void pnm::to_yca(image const& img, ExEdit::PixelYCA* dst, size_t dst_stride)
+{
+	auto* src = img.rgba.data();
+	for (int y = 0; y < img.h; y++, dst += dst_stride) {
+		auto* dst_x = dst;
+		for (int x = img.w; --x >= 0; src += 4, dst_x++) {
+			auto const yc = buff::fromRGB(src[0], src[1], src[2]);
+			*dst_x = {
+				.y = yc.y, .cb = yc.cb, .cr = yc.cr,
+				.a = static_cast<i16>((src[3] * max_alpha + 127) / 255),
+			};
+		}
+	}
+}
+
+void pnm::from_yca(ExEdit::PixelYCA const* src, size_t src_stride, int w, int h, image& img)
+{
+	// the inverse of buff::fromRGB(), where 4096 in Y maps to 255.
+	constexpr auto to8 = [](int v) {
+		return static_cast<uint8_t>(std::clamp((v + (1 << 15)) >> 16, 0, 255));
+	};
+	img.w = w; img.h = h;
+	img.rgba.resize(size_t(w) * h * 4);
+	auto* dst = img.rgba.data();
+	for (int y = 0; y < h; y++, src += src_stride) {
+		auto* src_x = src;
+		for (int x = w; --x >= 0; src_x++, dst += 4) {
+			// the filters leave the color of transparent pixels as it was.
+			if (src_x->a <= 0) { dst[0] = dst[1] = dst[2] = dst[3] = 0; continue; }
+			int const Y = 4080 * src_x->y;
+			dst[0] = to8(Y + 5720 * src_x->cr);
+			dst[1] = to8(Y - 1404 * src_x->cb - 2914 * src_x->cr);
+			dst[2] = to8(Y + 7230 * src_x->cb);
+			dst[3] = static_cast<uint8_t>((std::clamp<int>(src_x->a, 0, max_alpha) * 255 + (max_alpha >> 1)) >> log2_max_alpha);
+		}
+	}
+}
@@ -0,0 +1,42 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <exedit/pixel.hpp>
+
+
+////////////////////////////////
+// PAM/PNM 画像の入出力．
+////////////////////////////////
+namespace pnm
+{
+	// an image of 8-bit RGBA samples.
+	struct image {
+		int w = 0, h = 0;
+		std::vector<uint8_t> rgba;
+	};
+
+	// reads an image of PAM (P7) or binary PNM (P5, P6).
+	// returns false at the end of the stream; throws std::runtime_error if malformed.
+	bool read(std::FILE* fp, image& img);
+	// writes the image as PAM of RGB_ALPHA.
+	void write(std::FILE* fp, image const& img);
+
+	// converts between RGBA and YCA, by the same formula as ExEdit.
+	void to_yca(image const& img, ExEdit::PixelYCA* dst, size_t dst_stride);
+	void from_yca(ExEdit::PixelYCA const* src, size_t src_stride, int w, int h, image& img);
+}
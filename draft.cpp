@@ -0,0 +1,120 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <exedit/pixel.hpp>
+
+#include "arithmetics.hpp"
+#include "multi_thread.hpp"
+#include "draft.hpp"
+
+using namespace Calculation;
+using i16 = int16_t;
+using Filter::frame;
+
+
+////////////////////////////////
+// 縮小と拡大．
+////////////////////////////////
+frame Filter::Draft::reduce(frame const& fr, pool p)
+{
+	int const f = fr.draft,
+		w = (fr.obj_w + f - 1) / f, h = (fr.obj_h + f - 1) / f,
+		max_w = (fr.max_w + f - 1) / f, max_h = (fr.max_h + f - 1) / f,
+		line = max_w + 8;
+	// some kernels touch a few rows above the image, as for Incremental::part_of().
+	size_t const guard = 4 * line + 8,
+		len = frame::heap_size(max_w, max_h) / sizeof(ExEdit::PixelYCA) + guard;
+	thread_local std::vector<ExEdit::PixelYCA> edit, temp, heap;
+	for (auto* buf : { &edit, &temp, &heap })
+		if (buf->size() < len) buf->resize(len);
+
+	frame small{
+		.obj_edit = edit.data() + guard, .obj_temp = temp.data() + guard,
+		.obj_w = w, .obj_h = h, .obj_line = line,
+		.max_w = max_w, .max_h = max_h,
+		.heap = heap.data() + guard,
+		.alpha8 = fr.alpha8,
+	};
+
+	// merge each block of `f` x `f` pixels.
+	int const area = f * f;
+	multi_thread(h, [&](int thread_id, int thread_num) {
+		int const y0 = h * thread_id / thread_num, y1 = h * (thread_id + 1) / thread_num;
+		for (int y = y0; y < y1; y++) {
+			int const sy0 = y * f, sy1 = std::min(sy0 + f, fr.obj_h);
+			auto dst = small.obj_edit + y * line;
+			for (int x = 0; x < w; x++, dst++) {
+				int const sx0 = x * f, sx1 = std::min(sx0 + f, fr.obj_w);
+				int sum = 0, hi = 0, lo = sx1 - sx0 < f || sy1 - sy0 < f ? 0 : max_alpha;
+				for (int sy = sy0; sy < sy1; sy++) {
+					auto src = fr.obj_edit + sx0 + sy * fr.obj_line;
+					for (int sx = sx0; sx < sx1; sx++, src++) {
+						int const a = std::clamp<int>(src->a, 0, max_alpha);
+						sum += a; hi = std::max(hi, a); lo = std::min(lo, a);
+					}
+				}
+				int const a = p == pool::max ? hi : p == pool::min ? lo : (sum + (area >> 1)) / area;
+				*dst = { .y = 0, .cb = 0, .cr = 0, .a = static_cast<i16>(a) };
+			}
+		}
+	});
+	return small;
+}
+
+void Filter::Draft::expand(Cache::plane const& src, int src_org, int factor,
+	i16* dst_buf, size_t dst_step, size_t dst_stride, int dst_w, int dst_h, int dst_org)
+{
+	if (dst_w <= 0 || dst_h <= 0) return;
+
+	// where the center of a destination pixel lies on `src`, in units of 1/(2 * factor) pixels,
+	// split into the index of the nearer pixel on the top-left and the weight for the next one.
+	int const den = 2 * factor;
+	auto locate = [&](int i) {
+		int const pos = 2 * (i + dst_org) + 1 - factor - den * src_org,
+			idx = arith::floor_div(pos, den);
+		return std::pair{ idx, pos - den * idx };
+	};
+	std::vector<std::pair<int, int>> cols(dst_w);
+	for (int x = 0; x < dst_w; x++) cols[x] = locate(x);
+
+	// the columns of `src` that the destination refers to.
+	auto const& bd = src.bd;
+	int const col_l = cols.front().first, col_r = cols.back().first + 2,
+		in_l = std::clamp(bd.L, col_l, col_r), in_r = std::clamp(bd.R, col_l, col_r);
+	multi_thread(dst_h, [&](int thread_id, int thread_num) {
+		int const y0 = dst_h * thread_id / thread_num, y1 = dst_h * (thread_id + 1) / thread_num;
+		std::vector<int> row(col_r - col_l);
+		for (int y = y0; y < y1; y++) {
+			// interpolate vertically first, into a row of `src`.
+			auto const [sy, wy] = locate(y);
+			std::ranges::fill(row, 0);
+			for (auto [yy, w] : { std::pair{ sy, den - wy }, std::pair{ sy + 1, wy } }) {
+				if (yy < bd.T || yy >= bd.B || w == 0) continue;
+				auto s = src.buf + in_l * src.step + yy * src.stride;
+				for (int x = in_l; x < in_r; x++, s += src.step) row[x - col_l] += w * *s;
+			}
+
+			// then horizontally.
+			auto dst = dst_buf + y * dst_stride;
+			for (int x = 0; x < dst_w; x++, dst += dst_step) {
+				auto const [sx, wx] = cols[x];
+				*dst = static_cast<i16>((row[sx - col_l] * (den - wx) + row[sx + 1 - col_l] * wx
+					+ ((den * den) >> 1)) / (den * den));
+			}
+		}
+	});
+}
@@ -0,0 +1,54 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "buffer_base.hpp"
+#include "filter_core.hpp"
+#include "result_cache.hpp"
+
+
+////////////////////////////////
+// 縮小画像での下書き処理．
+////////////////////////////////
+namespace Filter::Draft
+{
+	// shapes whose radius on the scaled-down image is below this, in pixels,
+	// are computed in full quality, as they are cheap enough and would lose too much.
+	constexpr int min_radius = 16;
+
+	// how the pixels of the source are merged into one of the scaled-down image,
+	// so thin parts neither fade out nor swell up through the algorithm.
+	enum class pool {
+		none, // never scaled down, as the algorithm runs fast enough for any radius.
+		mean, // for the algorithms summing the alpha values.
+		max, // for those taking the maximum of the alpha values, before inflation.
+		min, // ditto, before deflation.
+	};
+
+	// whether the shape of the radius `radius_px` on `fr` is computed on the scaled-down image.
+	constexpr bool applies(frame const& fr, pool p, int radius_px) {
+		return fr.draft > 1 && p != pool::none && radius_px >= min_radius * fr.draft;
+	}
+
+	// a frame of the source of `fr` scaled down by `fr.draft`, on the buffers of this thread.
+	// each pixel merges the alpha of the pixels it covers by `p`, taking the outside as transparent.
+	frame reduce(frame const& fr, pool p);
+
+	// scales `src`, the result on the frame scaled down by `factor`, up onto `dst_w` x `dst_h` values at `dst_buf`,
+	// by bilinear interpolation taking the values outside `src.bd` as transparent.
+	// `src_org` and `dst_org` are where the value at (0, 0) of each lies, on the source of each frame.
+	void expand(Cache::plane const& src, int src_org, int factor,
+		int16_t* dst_buf, size_t dst_step, size_t dst_stride, int dst_w, int dst_h, int dst_org);
+}
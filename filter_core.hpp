@@ -0,0 +1,70 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include <exedit/pixel.hpp>
+
+
+////////////////////////////////
+// フィルタ処理の共通定義．
+////////////////////////////////
+namespace Filter
+{
+	enum class Algorithm : uint32_t {
+		bin = 0,
+		bin2x = 1,
+		sum = 2,
+		max = 3,
+		max_fast = 4,
+	};
+	constexpr int algorithm_count = 5;
+
+	// objects whose processed area is below this run on a single thread,
+	// as dispatching to the other threads costs more than the work itself.
+	constexpr int small_obj_area = 64 * 64;
+	// in a batch of frames, those of this area or larger split across the threads,
+	// rather than running on a single thread alongside the others.
+	constexpr int batch_split_area = 512 * 512;
+
+	namespace Incremental { struct history; }
+	namespace Sdf { class field; }
+
+	// the image to process and the buffers to process with,
+	// so the processing doesn't depend on ExEdit::FilterProcInfo.
+	struct frame {
+		ExEdit::PixelYCA* obj_edit; // the image, replaced by the result.
+		ExEdit::PixelYCA* obj_temp; // a buffer of the same capacity as `obj_edit`.
+		int obj_w, obj_h, obj_line;
+
+		// the maximum size of an image, which `obj_line` is no less than.
+		int max_w, max_h;
+		// working space, no less than `heap_size(max_w, max_h)` bytes.
+		void* heap;
+
+		// the previous frame of the same sequence, if any, to recompute only the changes.
+		Incremental::history* history = nullptr;
+		// the distance field shared by the filters on the same object, if any.
+		Sdf::field* sdf = nullptr;
+		// keeps the alpha of the source in 8 bits within the kernels, coarser but lighter.
+		bool alpha8 = false;
+		// computes the shapes of large radii on the image scaled down by this factor, 1 (off), 2 or 4,
+		// then scales them up; coarser but much faster, for previews.
+		int draft = 1;
+
+		static constexpr size_t heap_size(int max_w, int max_h) {
+			return sizeof(ExEdit::PixelYCA) * ((max_w + 8) * (max_h + 4) - 4);
+		}
+	};
+}
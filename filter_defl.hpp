@@ -12,6 +12,7 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 
 #include <cstdint>
 #include <algorithm>
+#include <optional>
 //#include <chrono>
 //
 //struct stopwatch {
@@ -25,10 +26,7 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 //	void resume() { start_at = clock::now(); }
 //};
 
-#define NOMINMAX
-#define WIN32_LEAN_AND_MEAN
-using byte = uint8_t;
-#include <exedit/FilterProcInfo.hpp>
+#include <exedit/pixel.hpp>
 
 #include "arithmetics.hpp"
 #include "multi_thread.hpp"
@@ -40,7 +38,10 @@ using byte = uint8_t;
 #include "kind_max_fast/inf_def.hpp"
 #include "kind_sum/inf_def.hpp"
 
-#include "CircleBorder_S.hpp"
+#include "filter_core.hpp"
+#include "result_cache.hpp"
+#include "sdf.hpp"
+#include "draft.hpp"
 
 using i16 = int16_t;
 using i32 = int32_t;
@@ -68,7 +69,7 @@ namespace Filter::Common::impl::exp
 
 		virtual process_spec tell_spec(int sum_size, int neg_size) const = 0;
 
-		// copy alpha values from `efpip->obj_edit` to `efpip->obj_temp`, contiguous with non-zero.
+		// copy alpha values from `fr.obj_edit` to `fr.obj_temp`, contiguous with non-zero.
 		// returns the stride of the destination buffer (if not dst_colored).
 		virtual void zero_op(int param_a, ExEdit::PixelYCA const* src_buf, size_t src_stride,
 			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride) const
@@ -79,12 +80,21 @@ namespace Filter::Common::impl::exp
 			else buff::copy_alpha(src_buf, src_stride, 0, 0, src_w, src_h,
 				dst_buf, dst_stride, 0, 0);
 		}
+		// `sink` is applied to each row of the result of the final pass right after it's written, if given.
 		virtual Bounds deflate_1(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const = 0;
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, row_sink const* sink) const = 0;
+		// the first of two passes keeps the summary of its result to `keep_hint`,
+		// which the second pass takes as `known`, classifying the blocks known uniform at once.
 		virtual Bounds deflate_2(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space) const = 0;
+			int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space, masking::hint* keep_hint) const = 0;
 		virtual Bounds inflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const = 0;
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, masking::hint const* known,
+			row_sink const* sink) const = 0;
+		// derives the deflation of the source from the distance field of `fr` instead, if the algorithm allows.
+		virtual std::optional<Bounds> deflate_sdf(int sum_size_raw, int param_a,
+			i16* dst_buf, bool dst_colored, size_t dst_stride, frame const& fr) const { return std::nullopt; }
+		// how the draft mode scales down the source to deflate.
+		virtual Draft::pool draft_pool() const { return Draft::pool::min; }
 
 	private:
 		struct sizing {
@@ -114,17 +124,58 @@ namespace Filter::Common::impl::exp
 		}
 
 	public:
+		// the distance within which the source affects the result, or -1 if invalid.
+		// one more pixel for the rounded rims of the disks.
+		int measure_reach(int size, int neg_size, int blur_px) const
+		{
+			auto const sz = measure(size, neg_size, blur_px);
+			if (sz.invalid) return -1;
+			return sz.sum_displace + sz.neg_displace + sz.blur_displace + 1;
+		}
+
 		struct defl_result {
 			int displace,
-				a_stride; // will be 4*efpip->obj_line if `colored` is true.
+				a_stride; // will be 4*fr.obj_line if `colored` is true.
 			bool is_empty, // entire image turned transparent.
 				colored;
 			bool invalid;
+
+			// where the alpha values are, for the result made from `fr`.
+			Cache::plane plane(frame const& fr) const
+			{
+				if (invalid || is_empty) return {};
+				return {
+					.buf = colored ? &fr.obj_temp->a : reinterpret_cast<i16*>(fr.obj_temp),
+					.step = colored ? 4u : 1u, .stride = static_cast<size_t>(a_stride),
+					.bd = { 0, 0, fr.obj_w - 2 * displace, fr.obj_h - 2 * displace },
+				};
+			}
 		};
+		// clears the alpha values of the pixels in { 0, 0, w, h } but out of `inner`, and applies `sink` to them.
+		static void sink_margins(row_sink const& sink, ExEdit::PixelYCA* buf, size_t stride, int w, int h, Bounds const& inner)
+		{
+			multi_thread(h, [&](int thread_id, int thread_num) {
+				int const y0 = thread_id * h / thread_num, y1 = (thread_id + 1) * h / thread_num;
+				for (int y = y0; y < y1; y++) {
+					auto const row = buf + y * stride;
+					buff::clear_alpha_margin(row, w, y, inner);
+					if (y < inner.T || y >= inner.B) sink.apply<4>(&row->a, 0, w, y);
+					else {
+						sink.apply<4>(&row->a, 0, std::min(inner.L, w), y);
+						sink.apply<4>(&row->a, std::max(inner.R, 0), w, y);
+					}
+				}
+			});
+		}
+
+		// if `with_colors` is given, the result may also take the colors of `fr.obj_edit`,
+		// clamping the alpha by the source, in which case `*with_colors` is set to true.
+		// if `margins` is given, the alpha values out of the bounds stored there are left for the caller to clear.
 		defl_result operator()(int size, int neg_size, int blur_px, int param_a,
-			bool dst_colored, bool tamely_diplace, ExEdit::FilterProcInfo* efpip) const
+			bool dst_colored, bool tamely_diplace, frame& fr, bool* with_colors = nullptr, Bounds* margins = nullptr) const
 		{
 			constexpr defl_result invalid{ .invalid = true };
+			if (with_colors != nullptr) *with_colors = false;
 			// calculate sizing values.
 			auto const sz = measure(size, neg_size, blur_px);
 			if (sz.invalid) return invalid;
@@ -134,61 +185,124 @@ namespace Filter::Common::impl::exp
 					std::max(sz.sum_size_raw + (sz.blur_size_raw >> 1) - sz.neg_size_raw - sz.blur_size_raw, 0) / den_radius :
 					std::max(displace, 0),
 				diff_displace = displace - result_displace;
+			if (margins != nullptr) *margins = { 0, 0, fr.obj_w - 2 * result_displace, fr.obj_h - 2 * result_displace };
+
+			if (auto const pool = draft_pool(); Draft::applies(fr, pool, sz.sum_size_raw / den_radius)) {
+				// compute on the scaled-down image, and scale the result up.
+				int const f = fr.draft;
+				frame small = Draft::reduce(fr, pool);
+				auto const result = (*this)((sz.sum_size_raw + (sz.blur_size_raw >> 1) - sz.neg_size_raw) / f,
+					sz.neg_size_raw / f, sz.blur_size_raw / f, param_a, false, tamely_diplace, small);
+				if (!result.invalid) {
+					if (result.is_empty) return {
+						.displace = result_displace,
+						.is_empty = true,
+					};
+					int const dst_w = fr.obj_w - 2 * result_displace, dst_h = fr.obj_h - 2 * result_displace,
+						dst_stride = dst_colored ? 4 * fr.obj_line : (dst_w + 1) & (-2);
+					Draft::expand(result.plane(small), result.displace, f,
+						dst_colored ? &fr.obj_temp->a : reinterpret_cast<i16*>(fr.obj_temp), dst_colored ? 4 : 1,
+						dst_stride, dst_w, dst_h, result_displace);
+					return { .displace = result_displace, .a_stride = dst_stride, .colored = dst_colored };
+				}
+			}
 
-			Bounds bd{ 0, 0, efpip->obj_w, efpip->obj_h };
+			Bounds bd{ 0, 0, fr.obj_w, fr.obj_h };
 			if (!sz.do_defl && !sz.do_infl) {
-				int const a_stride = dst_colored ? 4 * efpip->obj_line : (bd.wd() + 1) & (-2);
-				zero_op(param_a, efpip->obj_edit, efpip->obj_line, bd.wd(), bd.ht(),
-					dst_colored ? &efpip->obj_temp->a : reinterpret_cast<i16*>(efpip->obj_temp), dst_colored, a_stride);
+				int const a_stride = dst_colored ? 4 * fr.obj_line : (bd.wd() + 1) & (-2);
+				zero_op(param_a, fr.obj_edit, fr.obj_line, bd.wd(), bd.ht(),
+					dst_colored ? &fr.obj_temp->a : reinterpret_cast<i16*>(fr.obj_temp), dst_colored, a_stride);
 				return { .displace = 0, .a_stride = a_stride, .colored = dst_colored };
 			}
-			else if (2 * sz.sum_displace >= std::min(efpip->obj_w, efpip->obj_h))
+			else if (2 * sz.sum_displace >= std::min(fr.obj_w, fr.obj_h))
 				return { .is_empty = true };
+			else if (int const small_len = 2 * (sz.sum_displace + sz.neg_displace + sz.blur_displace + 2) + 1;
+				(fr.obj_w > small_len || fr.obj_h > small_len) &&
+				buff::is_opaque(fr.obj_edit, fr.obj_line, 0, 0, fr.obj_w, fr.obj_h)) {
+				// a fully opaque rectangle results in the same values all along each side,
+				// so process a smaller one and stretch its center row and column.
+				auto small = fr;
+				small.obj_w = std::min(fr.obj_w, small_len);
+				small.obj_h = std::min(fr.obj_h, small_len);
+				auto result = (*this)(size, neg_size, blur_px, param_a, dst_colored, tamely_diplace, small);
+				if (result.invalid || result.is_empty) return result;
+
+				int const d = 2 * result.displace;
+				if (dst_colored) buff::stretch_alpha(fr.obj_temp, fr.obj_line,
+					small.obj_w - d, small.obj_h - d, fr.obj_w - d, fr.obj_h - d, fr.heap);
+				else {
+					int const a_stride = (fr.obj_w - 2 * displace + 1) & (-2);
+					buff::stretch_alpha(reinterpret_cast<i16*>(fr.obj_temp), result.a_stride,
+						small.obj_w - d, small.obj_h - d, a_stride, fr.obj_w - d, fr.obj_h - d, fr.heap);
+					result.a_stride = a_stride;
+				}
+				return result;
+			}
 			else {
 				// adjust the destination to handle with negative deflation.
-				int const dst_stride = dst_colored ? 4 * efpip->obj_line : 
-					((efpip->obj_w - 2 * displace + 1) & (-2)),
+				int const dst_stride = dst_colored ? 4 * fr.obj_line : 
+					((fr.obj_w - 2 * displace + 1) & (-2)),
 					dst_step = dst_colored ? 4 : 1;
 				i16* const dst_buf = (dst_colored ?
-					&efpip->obj_temp->a : reinterpret_cast<i16*>(efpip->obj_temp))
+					&fr.obj_temp->a : reinterpret_cast<i16*>(fr.obj_temp))
 						+ diff_displace * (dst_step + dst_stride);
 
+				// take the colors of the source as the final pass writes each row, unless a blur follows.
+				int const dst_w = fr.obj_w - 2 * result_displace, dst_h = fr.obj_h - 2 * result_displace;
+				row_sink const sink = with_colors != nullptr && dst_colored && sz.blur_size_raw <= 0 ?
+					row_sink{ .colors = plane{ &fr.obj_edit->a, 4, 4 * static_cast<size_t>(fr.obj_line),
+						{ 0, 0, fr.obj_w, fr.obj_h } }.move(-result_displace, -result_displace) } : row_sink{};
+				bool sunk = false;
+
 				if (sz.do_infl) {
 					// allocate memory layout.
 					size_t const med_stride = (bd.wd() - 2 * sz.sum_displace + 1) & (-2);
 					i16* med_buffer; void* heap;
 					if (sz.allows_buffer_overlap) {
-						med_buffer = reinterpret_cast<i16*>(efpip->obj_temp);
-						heap = *exedit.memory_ptr;
+						med_buffer = reinterpret_cast<i16*>(fr.obj_temp);
+						heap = fr.heap;
 					}
 					else {
-						med_buffer = reinterpret_cast<i16*>(*exedit.memory_ptr);
+						med_buffer = reinterpret_cast<i16*>(fr.heap);
 						heap = med_buffer + med_stride * (bd.ht() - 2 * sz.sum_displace);
 					}
 
 					// then process by two passes.
+					thread_local masking::hint hint{};
+					hint.clear();
 					if (sz.do_defl) {
-						bd = deflate_2(sz.sum_size_raw, param_a,
-							efpip->obj_edit, efpip->obj_line, bd.wd(), bd.ht(),
-							med_buffer, med_stride, heap, efpip->obj_temp);
+						if (auto const sdf_bd = deflate_sdf(sz.sum_size_raw, param_a,
+							med_buffer, false, med_stride, fr)) bd = *sdf_bd;
+						else bd = deflate_2(sz.sum_size_raw, param_a,
+							fr.obj_edit, fr.obj_line, bd.wd(), bd.ht(),
+							med_buffer, med_stride, heap, fr.obj_temp, &hint);
 						if (bd.is_empty()) return {
 							.displace = result_displace,
 							.is_empty = true,
 						};
 					}
-					else zero_op(param_a, efpip->obj_edit, efpip->obj_line, bd.wd(), bd.ht(),
+					else zero_op(param_a, fr.obj_edit, fr.obj_line, bd.wd(), bd.ht(),
 						med_buffer, false, med_stride);
+					sunk = sink.colors.buf != nullptr;
+					row_sink const sink_here = sink.move(-(bd.L + diff_displace), -(bd.T + diff_displace));
 					bd = inflate_2(sz.neg_size_raw, param_a,
 						med_buffer + bd.L + bd.T * med_stride, med_stride, bd.wd(), bd.ht(),
-						dst_buf + bd.L * dst_step + bd.T * dst_stride, dst_colored, dst_stride, heap)
+						dst_buf + bd.L * dst_step + bd.T * dst_stride, dst_colored, dst_stride, heap, &hint,
+						sunk ? &sink_here : nullptr)
 						.move(bd.L + diff_displace, bd.T + diff_displace);
 				}
 				else {
 					// process by one pass.
-					bd = deflate_1(sz.sum_size_raw, param_a,
-						efpip->obj_edit, efpip->obj_line, bd.wd(), bd.ht(),
-						dst_buf, dst_colored, dst_stride, *exedit.memory_ptr)
-						.move(diff_displace, diff_displace);
+					if (auto const sdf_bd = deflate_sdf(sz.sum_size_raw, param_a,
+						dst_buf, dst_colored, dst_stride, fr)) bd = *sdf_bd;
+					else {
+						sunk = sink.colors.buf != nullptr;
+						row_sink const sink_here = sink.move(-diff_displace, -diff_displace);
+						bd = deflate_1(sz.sum_size_raw, param_a,
+							fr.obj_edit, fr.obj_line, bd.wd(), bd.ht(),
+							dst_buf, dst_colored, dst_stride, fr.heap, sunk ? &sink_here : nullptr);
+					}
+					bd = bd.move(diff_displace, diff_displace);
 				}
 				if (bd.is_empty()) return {
 					.displace = result_displace,
@@ -197,21 +311,26 @@ namespace Filter::Common::impl::exp
 
 				// apply blur.
 				if (sz.blur_size_raw > 0) {
-					if (dst_colored) buff::blur_alpha(efpip->obj_temp, efpip->obj_line,
+					if (dst_colored) buff::blur_alpha(fr.obj_temp, fr.obj_line,
 						bd.L, bd.T, bd.wd(), bd.ht(), (blur_px * buff::den_blur_px) / den_radius,
-						*exedit.memory_ptr);
-					else buff::blur_alpha(reinterpret_cast<i16*>(efpip->obj_temp), dst_stride,
+						fr.heap);
+					else buff::blur_alpha(reinterpret_cast<i16*>(fr.obj_temp), dst_stride,
 						bd.L, bd.T, bd.wd(), bd.ht(), (blur_px * buff::den_blur_px) / den_radius,
-						*exedit.memory_ptr);
+						fr.heap);
 
 					bd = bd.inflate_br(2 * sz.blur_displace);
 				}
 
 				// clear the four sides of margins if present.
-				int const dst_w = efpip->obj_w - 2 * result_displace, dst_h = efpip->obj_h - 2 * result_displace;
-				if (dst_colored) buff::clear_alpha_chrome(efpip->obj_temp, efpip->obj_line,
+				if (sunk) {
+					// the margins were not written by the kernels; let them take the colors too.
+					sink_margins(sink, fr.obj_temp, fr.obj_line, dst_w, dst_h, bd);
+					*with_colors = true;
+				}
+				else if (margins != nullptr) *margins = bd;
+				else if (dst_colored) buff::clear_alpha_chrome(fr.obj_temp, fr.obj_line,
 					{ 0, 0, dst_w, dst_h }, bd);
-				else buff::clear_alpha_chrome(reinterpret_cast<i16*>(efpip->obj_temp), dst_stride,
+				else buff::clear_alpha_chrome(reinterpret_cast<i16*>(fr.obj_temp), dst_stride,
 					{ 0, 0, dst_w, dst_h }, bd);
 
 				return { .displace = result_displace, .a_stride = dst_stride, .colored = dst_colored };
@@ -223,10 +342,12 @@ namespace Filter::Common::impl::exp
 	template<size_t den_radius, size_t max_param_a>
 	struct defl_bin_base : defl_base<den_radius> {
 	protected:
-		using defl_base<den_radius>::process_spec;
+		using typename defl_base<den_radius>::process_spec;
 		static constexpr i16 to_thresh(int param_a) {
 			return static_cast<i16>((max_alpha - 1) * param_a / max_param_a);
 		}
+		// these run fast enough for any radius, faster than scaling up the result.
+		Draft::pool draft_pool() const override { return Draft::pool::none; }
 		void zero_op(int param_a, ExEdit::PixelYCA const* src_buf, size_t src_stride,
 			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride) const override
 		{
@@ -237,7 +358,7 @@ namespace Filter::Common::impl::exp
 					dst_buf, dst_stride, 0, 0, to_thresh(param_a));
 		}
 		Bounds deflate_2(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space) const override
+			int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space, masking::hint* keep_hint) const override
 		{
 			return bin::deflate(src_w, src_h,
 				&src_buf->a, true, 4 * src_stride, to_thresh(param_a),
@@ -250,7 +371,7 @@ namespace Filter::Common::impl::exp
 	template<size_t den_radius, size_t max_param_a>
 	struct defl_bin : defl_bin_base<den_radius, max_param_a> {
 	protected:
-		using defl_bin_base<den_radius, max_param_a>::process_spec;
+		using typename defl_bin_base<den_radius, max_param_a>::process_spec;
 		using defl_bin_base<den_radius, max_param_a>::to_thresh;
 
 		process_spec tell_spec(int sum_size, int neg_size) const override
@@ -267,20 +388,29 @@ namespace Filter::Common::impl::exp
 		}
 
 		Bounds deflate_1(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const override
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, row_sink const* sink) const override
 		{
 			return bin::deflate(src_w, src_h,
 				&src_buf->a, true, 4 * src_stride, to_thresh(param_a),
 				dst_buf, dst_colored, dst_stride,
-				heap, (sum_size_raw * sum_size_raw) / (den_radius * den_radius));
+				heap, (sum_size_raw * sum_size_raw) / (den_radius * den_radius), sink);
 		}
 		Bounds inflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const override
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, masking::hint const* known,
+			row_sink const* sink) const override
 		{
 			return bin::inflate(src_w, src_h,
 				src_buf, false, src_stride, 0,
 				dst_buf, dst_colored, dst_stride,
-				heap, (neg_size_raw * neg_size_raw) / (den_radius * den_radius));
+				heap, (neg_size_raw * neg_size_raw) / (den_radius * den_radius), sink);
+		}
+		std::optional<Bounds> deflate_sdf(int sum_size_raw, int param_a,
+			i16* dst_buf, bool dst_colored, size_t dst_stride, frame const& fr) const override
+		{
+			auto* const field = Sdf::of(fr, to_thresh(param_a));
+			if (field == nullptr) return std::nullopt;
+			return Sdf::deflate(*field, (sum_size_raw * sum_size_raw) / (den_radius * den_radius),
+				dst_buf, dst_colored, dst_stride);
 		}
 	};
 
@@ -288,7 +418,7 @@ namespace Filter::Common::impl::exp
 	template<size_t den_radius, size_t max_param_a>
 	struct defl_bin2x : defl_bin_base<den_radius, max_param_a> {
 	protected:
-		using defl_bin_base<den_radius, max_param_a>::process_spec;
+		using typename defl_bin_base<den_radius, max_param_a>::process_spec;
 		using defl_bin_base<den_radius, max_param_a>::to_thresh;
 
 		process_spec tell_spec(int sum_size, int neg_size) const override
@@ -306,28 +436,30 @@ namespace Filter::Common::impl::exp
 		}
 
 		Bounds deflate_1(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const override
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, row_sink const* sink) const override
 		{
 			return bin2x::deflate(src_w, src_h,
 				&src_buf->a, true, 4 * src_stride, to_thresh(param_a),
 				dst_buf, dst_colored, dst_stride,
-				heap, (4 * sum_size_raw * sum_size_raw) / (den_radius * den_radius));
+				heap, (4 * sum_size_raw * sum_size_raw) / (den_radius * den_radius), sink);
 		}
 		Bounds inflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const override
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, masking::hint const* known,
+			row_sink const* sink) const override
 		{
 			return bin2x::inflate(src_w, src_h,
 				src_buf, false, src_stride, 0,
 				dst_buf, dst_colored, dst_stride,
-				heap, (4 * neg_size_raw * neg_size_raw) / (den_radius * den_radius));
+				heap, (4 * neg_size_raw * neg_size_raw) / (den_radius * den_radius), sink);
 		}
 	};
 
 	// algorithm "max".
-	template<size_t den_radius>
+	// P: the precision of the alpha kept during the deflation of the colored source.
+	template<size_t den_radius, class P = alpha12>
 	struct defl_max : defl_base<den_radius> {
 	protected:
-		using defl_base<den_radius>::process_spec;
+		using typename defl_base<den_radius>::process_spec;
 
 		process_spec tell_spec(int sum_size, int neg_size) const override
 		{
@@ -343,35 +475,36 @@ namespace Filter::Common::impl::exp
 		}
 
 		Bounds deflate_1(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, row_sink const* sink) const
 		{
-			return max::deflate(src_w, src_h,
+			return max::deflate<P>(src_w, src_h,
 				src_buf, src_stride,
 				dst_buf, dst_colored, dst_stride,
 				reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(heap) + max::alpha_space_size(src_w, src_h)),
-				(sum_size_raw * sum_size_raw) / (den_radius * den_radius), heap);
+				(sum_size_raw * sum_size_raw) / (den_radius * den_radius), heap, nullptr, sink);
 		}
 		Bounds deflate_2(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space) const
+			int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space, masking::hint* keep_hint) const
 		{
-			return max::deflate(src_w, src_h, src_buf, src_stride,
+			return max::deflate<P>(src_w, src_h, src_buf, src_stride,
 				dst_buf, false, dst_stride,
-				heap, (sum_size_raw * sum_size_raw) / (den_radius * den_radius), alpha_space);
+				heap, (sum_size_raw * sum_size_raw) / (den_radius * den_radius), alpha_space, keep_hint);
 		}
 		Bounds inflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, masking::hint const* known,
+			row_sink const* sink) const
 		{
 			return max::inflate(src_w, src_h, src_buf, src_stride,
 				dst_buf, dst_colored, dst_stride,
-				heap, (neg_size_raw * neg_size_raw) / (den_radius * den_radius));
+				heap, (neg_size_raw * neg_size_raw) / (den_radius * den_radius), known, sink);
 		}
 	};
 
 	// algorithm "max_fast".
-	template<size_t den_radius>
+	template<size_t den_radius, class P = alpha12>
 	struct defl_max_fast : defl_base<den_radius> {
 	protected:
-		using defl_base<den_radius>::process_spec;
+		using typename defl_base<den_radius>::process_spec;
 
 		process_spec tell_spec(int sum_size, int neg_size) const override
 		{
@@ -387,39 +520,40 @@ namespace Filter::Common::impl::exp
 		}
 
 		Bounds deflate_1(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, row_sink const* sink) const
 		{
-			return max_fast::deflate(src_w, src_h,
+			return max_fast::deflate<P>(src_w, src_h,
 				src_buf, src_stride,
 				dst_buf, dst_colored, dst_stride,
 				reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(heap) + max_fast::alpha_space_size(src_w, src_h)),
-				(sum_size_raw * sum_size_raw) / (den_radius * den_radius), heap);
+				(sum_size_raw * sum_size_raw) / (den_radius * den_radius), heap, nullptr, sink);
 		}
 		Bounds deflate_2(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space) const
+			int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space, masking::hint* keep_hint) const
 		{
-			return max_fast::deflate(src_w, src_h, src_buf, src_stride,
+			return max_fast::deflate<P>(src_w, src_h, src_buf, src_stride,
 				dst_buf, false, dst_stride,
-				heap, (sum_size_raw * sum_size_raw) / (den_radius * den_radius), alpha_space);
+				heap, (sum_size_raw * sum_size_raw) / (den_radius * den_radius), alpha_space, keep_hint);
 		}
 		Bounds inflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, masking::hint const* known,
+			row_sink const* sink) const
 		{
 			return max_fast::inflate(src_w, src_h, src_buf, src_stride,
 				dst_buf, dst_colored, dst_stride,
-				heap, (neg_size_raw * neg_size_raw) / (den_radius * den_radius));
+				heap, (neg_size_raw * neg_size_raw) / (den_radius * den_radius), known, sink);
 		}
 	};
 
 	// algorithm "sum".
-	template<size_t den_radius, size_t max_param_a>
+	template<size_t den_radius, size_t max_param_a, class P = alpha12>
 	struct defl_sum : defl_base<den_radius> {
 		constexpr static int to_cap_rate(int param_a) {
 			return sum::den_cap_rate * param_a / max_param_a;
 		}
 
 	protected:
-		using defl_base<den_radius>::process_spec;
+		using typename defl_base<den_radius>::process_spec;
 
 		process_spec tell_spec(int sum_size, int neg_size) const override
 		{
@@ -433,28 +567,30 @@ namespace Filter::Common::impl::exp
 				.allows_buffer_overlap = false,
 			};
 		}
+		Draft::pool draft_pool() const override { return Draft::pool::mean; }
 
 		Bounds deflate_1(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, row_sink const* sink) const
 		{
-			return sum::deflate(src_w, src_h, src_buf, src_stride,
+			return sum::deflate<P>(src_w, src_h, src_buf, src_stride,
 				dst_buf, dst_colored, dst_stride, to_cap_rate(param_a),
 				reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(heap) + sum::alpha_space_size(src_w, src_h)),
-				(sum_size_raw * sum_size_raw) / (den_radius * den_radius), heap);
+				(sum_size_raw * sum_size_raw) / (den_radius * den_radius), heap, nullptr, sink);
 		}
 		Bounds deflate_2(int sum_size_raw, int param_a, ExEdit::PixelYCA* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space) const
+			int src_w, int src_h, i16* dst_buf, size_t dst_stride, void* heap, void* alpha_space, masking::hint* keep_hint) const
 		{
-			return sum::deflate(src_w, src_h, src_buf, src_stride,
+			return sum::deflate<P>(src_w, src_h, src_buf, src_stride,
 				dst_buf, false, dst_stride, to_cap_rate(param_a),
-				heap, (sum_size_raw * sum_size_raw) / (den_radius * den_radius), alpha_space);
+				heap, (sum_size_raw * sum_size_raw) / (den_radius * den_radius), alpha_space, keep_hint);
 		}
 		Bounds inflate_2(int neg_size_raw, int param_a, i16* src_buf, size_t src_stride,
-			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap) const
+			int src_w, int src_h, i16* dst_buf, bool dst_colored, size_t dst_stride, void* heap, masking::hint const* known,
+			row_sink const* sink) const
 		{
 			return sum::inflate(src_w, src_h, src_buf, src_stride,
 				dst_buf, dst_colored, dst_stride, to_cap_rate(param_a),
-				heap, (neg_size_raw * neg_size_raw) / (den_radius * den_radius));
+				heap, (neg_size_raw * neg_size_raw) / (den_radius * den_radius), known, sink);
 		}
 	};
 }
@@ -0,0 +1,179 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#include <exedit/pixel.hpp>
+
+#include "multi_thread.hpp"
+#include "incremental.hpp"
+
+using namespace Calculation;
+using Filter::frame;
+using Filter::Incremental::history;
+
+
+////////////////////////////////
+// 履歴の照合と記録．
+////////////////////////////////
+bool history::matches(std::initializer_list<int32_t> args, int reach, size_t meta_size, frame const& fr) const
+{
+	return !out_bd.is_empty() && this->reach == reach && meta.size() == meta_size &&
+		src_w == fr.obj_w && src_h == fr.obj_h && max_w == fr.max_w && max_h == fr.max_h &&
+		std::equal(this->args.begin(), this->args.end(), args.begin(), args.end());
+}
+
+Bounds Filter::Incremental::changed_rect(history const& hist, frame const& fr)
+{
+	int const w = fr.obj_w, h = fr.obj_h;
+	// the range of changed pixels in each row, empty if none.
+	std::vector<std::pair<int, int>> spans(h);
+	MultiThread::chunks rows{ multi_thread, h };
+	multi_thread(h, [&](int thread_id, int thread_num) {
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+			auto const src = fr.obj_edit + y * fr.obj_line;
+			auto const prev = hist.src.data() + y * w;
+			int l = 0, r = w;
+			while (l < r && src[l].a == prev[l]) l++;
+			while (l < r && src[r - 1].a == prev[r - 1]) r--;
+			spans[y] = { l, r };
+		}
+	});
+
+	Bounds ret{ w, h, 0, 0 };
+	for (int y = 0; y < h; y++) {
+		auto [l, r] = spans[y];
+		if (l >= r) continue;
+		ret.L = std::min(ret.L, l); ret.R = std::max(ret.R, r);
+		ret.T = std::min(ret.T, y); ret.B = y + 1;
+	}
+	return ret;
+}
+
+void Filter::Incremental::record(history& hist, std::initializer_list<int32_t> args, int reach,
+	void const* meta, size_t meta_size, frame const& fr, Cache::plane const& pl)
+{
+	int const w = fr.obj_w, h = fr.obj_h;
+	hist.args.assign(args);
+	hist.reach = reach;
+	hist.src_w = w; hist.src_h = h;
+	hist.max_w = fr.max_w; hist.max_h = fr.max_h;
+	hist.meta.resize(meta_size);
+	std::memcpy(hist.meta.data(), meta, meta_size);
+
+	hist.src.resize(static_cast<size_t>(w) * h);
+	hist.out_bd = pl.bd.is_empty() ? Bounds{} : pl.bd;
+	hist.out.resize(static_cast<size_t>(hist.out_bd.wd()) * hist.out_bd.ht());
+
+	multi_thread(h, [&](int thread_id, int thread_num) {
+		int const y0 = h * thread_id / thread_num, y1 = h * (thread_id + 1) / thread_num;
+		for (int y = y0; y < y1; y++) {
+			auto src = fr.obj_edit + y * fr.obj_line;
+			auto dst = hist.src.data() + y * w;
+			for (int x = w; --x >= 0; src++, dst++) *dst = src->a;
+		}
+	});
+
+	auto const& bd = hist.out_bd;
+	if (bd.is_empty()) return;
+	multi_thread(bd.ht(), [&](int thread_id, int thread_num) {
+		int const y0 = bd.ht() * thread_id / thread_num, y1 = bd.ht() * (thread_id + 1) / thread_num;
+		for (int y = y0; y < y1; y++) {
+			auto src = pl.buf + bd.L * pl.step + (bd.T + y) * pl.stride;
+			auto dst = hist.out.data() + y * bd.wd();
+			for (int x = bd.wd(); --x >= 0; src += pl.step, dst++) *dst = *src;
+		}
+	});
+}
+
+bool Filter::Incremental::restore(history const& hist, Cache::plane const& pl)
+{
+	auto const& bd = hist.out_bd;
+	if (pl.bd.L != bd.L || pl.bd.T != bd.T || pl.bd.R != bd.R || pl.bd.B != bd.B) return false;
+
+	multi_thread(bd.ht(), [&](int thread_id, int thread_num) {
+		int const y0 = bd.ht() * thread_id / thread_num, y1 = bd.ht() * (thread_id + 1) / thread_num;
+		for (int y = y0; y < y1; y++) {
+			auto src = hist.out.data() + y * bd.wd();
+			auto dst = pl.buf + bd.L * pl.step + (bd.T + y) * pl.stride;
+			for (int x = bd.wd(); --x >= 0; src++, dst += pl.step) *dst = *src;
+		}
+	});
+	return true;
+}
+
+
+////////////////////////////////
+// 部分の再計算．
+////////////////////////////////
+frame Filter::Incremental::part_of(frame const& fr, Bounds const& part)
+{
+	// leave the same room around the image, so the sizes are limited in the same way.
+	int const max_w = part.wd() + (fr.max_w - fr.obj_w), max_h = part.ht() + (fr.max_h - fr.obj_h),
+		line = max_w + 8;
+	// ExEdit places its buffers within a larger block of memory,
+	// and some kernels touch a few rows above the image.
+	size_t const guard = 4 * line + 8,
+		len = frame::heap_size(max_w, max_h) / sizeof(ExEdit::PixelYCA) + guard;
+	thread_local std::vector<ExEdit::PixelYCA> edit, temp, heap;
+	for (auto* buf : { &edit, &temp, &heap })
+		if (buf->size() < len) buf->resize(len);
+
+	frame sub{
+		.obj_edit = edit.data() + guard, .obj_temp = temp.data() + guard,
+		.obj_w = part.wd(), .obj_h = part.ht(), .obj_line = line,
+		.max_w = max_w, .max_h = max_h,
+		.heap = heap.data() + guard,
+	};
+	for (int y = 0; y < part.ht(); y++)
+		std::memcpy(sub.obj_edit + y * line, fr.obj_edit + part.L + (part.T + y) * fr.obj_line,
+			sizeof(ExEdit::PixelYCA) * part.wd());
+	return sub;
+}
+
+void Filter::Incremental::splice(history& hist, Cache::plane const& sub, Bounds const& part,
+	Bounds const& changed, frame const& fr)
+{
+	// the result is placed by the same offset from the source both for the part and the whole.
+	auto const& bd = hist.out_bd;
+	int const ofs = bd.L + (bd.wd() - fr.obj_w) / 2;
+	Bounds rect = changed.inflate(hist.reach).move(ofs, ofs);
+	rect = {
+		std::max(rect.L, bd.L), std::max(rect.T, bd.T),
+		std::min(rect.R, bd.R), std::min(rect.B, bd.B),
+	};
+
+	if (!rect.is_empty()) multi_thread(rect.ht(), [&](int thread_id, int thread_num) {
+		int const y0 = rect.T + rect.ht() * thread_id / thread_num,
+			y1 = rect.T + rect.ht() * (thread_id + 1) / thread_num;
+		for (int y = y0; y < y1; y++) {
+			auto dst = hist.out.data() + (rect.L - bd.L) + (y - bd.T) * bd.wd();
+			int const sub_y = y - part.T;
+			if (sub.bd.is_empty() || sub_y < sub.bd.T || sub_y >= sub.bd.B) {
+				std::fill_n(dst, rect.wd(), int16_t{ 0 });
+				continue;
+			}
+			auto const src = sub.buf + sub_y * sub.stride;
+			for (int x = rect.L - part.L; x < rect.R - part.L; x++, dst++)
+				*dst = sub.bd.L <= x && x < sub.bd.R ? src[x * sub.step] : 0;
+		}
+	});
+
+	for (int y = changed.T; y < changed.B; y++) {
+		auto src = fr.obj_edit + changed.L + y * fr.obj_line;
+		auto dst = hist.src.data() + changed.L + y * fr.obj_w;
+		for (int x = changed.wd(); --x >= 0; src++, dst++) *dst = src->a;
+	}
+}
@@ -0,0 +1,111 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+#include "buffer_base.hpp"
+#include "filter_core.hpp"
+#include "result_cache.hpp"
+
+
+////////////////////////////////
+// 変化した部分のみの再計算．
+////////////////////////////////
+namespace Filter::Incremental
+{
+	// the source and the result of the previous frame in a sequence,
+	// so the next frame recomputes only around the part where the source changed.
+	struct history {
+		std::vector<int32_t> args;
+		int src_w = 0, src_h = 0, max_w = 0, max_h = 0, reach = -1;
+		std::vector<std::byte> meta;
+		std::vector<int16_t> src; // the alpha values of the source.
+		std::vector<int16_t> out; // the alpha values of the result within `out_bd`.
+		Calculation::Bounds out_bd{};
+
+		// whether the result for `args` on `fr` can be derived from this.
+		bool matches(std::initializer_list<int32_t> args, int reach, size_t meta_size, frame const& fr) const;
+	};
+
+	// the bounding box of the alpha values of `fr.obj_edit` that differ from `hist.src`.
+	Calculation::Bounds changed_rect(history const& hist, frame const& fr);
+	// takes `fr` and its result as the new history.
+	void record(history& hist, std::initializer_list<int32_t> args, int reach,
+		void const* meta, size_t meta_size, frame const& fr, Cache::plane const& pl);
+	// copies the result of the history onto `pl`. returns false if it doesn't fit.
+	bool restore(history const& hist, Cache::plane const& pl);
+	// a frame of the part `part` of the source of `fr`, on the buffers of this thread.
+	frame part_of(frame const& fr, Calculation::Bounds const& part);
+	// overwrites the result of the history around `changed` by `sub`, the result for `part`,
+	// and takes the source of `fr` within `changed`.
+	void splice(history& hist, Cache::plane const& sub, Calculation::Bounds const& part,
+		Calculation::Bounds const& changed, frame const& fr);
+
+	// whether through() keeps the result for `fr` either in the history or in Filter::Cache.
+	inline bool keeps(frame const& fr) { return fr.history != nullptr || Cache::keeps(fr); }
+
+	// returns the result of `compute(fr)` as it would be,
+	// recomputing only the part around the changes from `fr.history` if possible.
+	// `reach_of(fr)` tells the distance within which the source affects the result, or -1 if invalid,
+	// and the results are assumed to have `displace` and be placed by the same offset as for the whole.
+	// looks up Filter::Cache first.
+	auto through(char tag, std::initializer_list<int32_t> args, auto&& reach_of, frame& fr,
+		auto&& compute, auto&& plane_of)
+	{
+		return Cache::through(tag, args, fr, [&](frame& fr) {
+			using result = decltype(compute(fr));
+			using Calculation::Bounds;
+			history* const hist = fr.history;
+			// the draft mode scales down on a grid that a part of the frame wouldn't share.
+			int const reach = hist != nullptr && fr.draft <= 1 ? reach_of(fr) : -1;
+			if (reach < 0) return compute(fr);
+
+			if (hist->matches(args, reach, sizeof(result), fr)) {
+				result ret;
+				std::memcpy(&ret, hist->meta.data(), sizeof(ret));
+
+				Bounds const changed = changed_rect(*hist, fr);
+				if (changed.is_empty()) {
+					if (restore(*hist, plane_of(ret, fr))) return ret;
+				}
+				else {
+					// the result around `changed` depends on the source twice as far.
+					Bounds part = changed.inflate(2 * reach);
+					part = {
+						std::max(part.L, 0), std::max(part.T, 0),
+						std::min(part.R, fr.obj_w), std::min(part.B, fr.obj_h),
+					};
+					if (2 * part.wd() * part.ht() <= fr.obj_w * fr.obj_h) {
+						frame sub = part_of(fr, part);
+						if (reach_of(sub) == reach) {
+							auto const sub_ret = compute(sub);
+							if (sub_ret.displace == ret.displace) {
+								splice(*hist, plane_of(sub_ret, sub), part, changed, fr);
+								if (restore(*hist, plane_of(ret, fr))) return ret;
+							}
+						}
+					}
+				}
+			}
+
+			auto const ret = compute(fr);
+			record(*hist, args, reach, &ret, sizeof(ret), fr, plane_of(ret, fr));
+			return ret;
+		}, plane_of);
+	}
+}
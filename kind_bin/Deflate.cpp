@@ -26,10 +26,11 @@ static inline void pass1(int src_w, int src_h, int size,
 	i16 const* a_buf, size_t a_stride, i16 thresh,
 	i32* med_buf, size_t med_stride)
 {
-	multi_thread(src_h, [=](int thread_id, int thread_num) {
+	MultiThread::chunks rows{ multi_thread, src_h };
+	multi_thread(src_h, [=, &rows](int thread_id, int thread_num) {
 		int dst_w = src_w - 2 * size;
 
-		for (int y = thread_id; y < src_h; y += thread_num) {
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 			auto a_buf_y = a_buf + size * a_step + y * a_stride;
 			auto m_buf_y = med_buf + y * med_stride;
 
@@ -68,7 +69,7 @@ static inline void pass1(int src_w, int src_h, int size,
 template<size_t a_step>
 static inline void pass2(int src_w, int src_h, int size,
 	i32 const* med_buf, size_t med_stride,
-	i16* a_buf, size_t a_stride, i32 const* arc, i32* cnt_buf)
+	i16* a_buf, size_t a_stride, i32 const* arc, i32* cnt_buf, row_sink const* sink)
 {
 	auto dst_w = src_w - 2 * size, dst_h = src_h - 2 * size;
 	multi_thread(dst_w, [=](int thread_id, int thread_num) {
@@ -125,6 +126,7 @@ static inline void pass2(int src_w, int src_h, int size,
 				if (*m_buf_y <= size) *count = std::max(*count, arc[*m_buf_y]);
 				if (*count >= 0) *a_buf_y = 0; // std::min(*a_buf_y, 0)
 			}
+			if (sink != nullptr) sink->apply<a_step>(a_buf + y * a_stride, x0, x1, y);
 		}
 	});
 }
@@ -132,7 +134,7 @@ static inline void pass2(int src_w, int src_h, int size,
 Bounds bin::deflate(int src_w, int src_h,
 	i16 const* src_buf, bool src_colored, size_t src_stride, i16 thresh,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq)
+	void* heap, int size_sq, row_sink const* sink)
 {
 	auto* const arc = reinterpret_cast<i32*>(heap);
 	int size = arith::arc::quarter(size_sq, arc);
@@ -144,7 +146,7 @@ Bounds bin::deflate(int src_w, int src_h,
 		(src_w, src_h, size, src_buf, src_stride, thresh, med_buf, dst_w);
 
 	(dst_colored ? pass2<4> : pass2<1>)
-		(src_w, src_h, size, med_buf, dst_w, dst_buf, dst_stride, arc, cnt_buf);
+		(src_w, src_h, size, med_buf, dst_w, dst_buf, dst_stride, arc, cnt_buf, sink);
 
 	return { 0, 0, src_w - 2 * size, src_h - 2 * size };
 }
@@ -17,10 +17,11 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 
 namespace Calculation::bin
 {
+	// if `sink` is given, it's applied to each row of the result right after it's written.
 	Bounds inflate(int src_w, int src_h,
 		i16 const* src_buf, bool src_colored, size_t src_stride, i16 thresh,
 		i16* dst_buf, bool dst_colored, size_t dst_stride,
-		void* heap, int size_sq);
+		void* heap, int size_sq, row_sink const* sink = nullptr);
 
 	template<int denom>
 	constexpr int inflate_radius(int numer) { return numer / denom; }
@@ -29,10 +30,11 @@ namespace Calculation::bin
 		return sizeof(i32) * (dst_w * dst_h + size + 1);
 	}
 
+	// if `sink` is given, it's applied to each row of the result right after it's written.
 	Bounds deflate(int src_w, int src_h,
 		i16 const* src_buf, bool src_colored, size_t src_stride, i16 thresh,
 		i16* dst_buf, bool dst_colored, size_t dst_stride,
-		void* heap, int size_sq);
+		void* heap, int size_sq, row_sink const* sink = nullptr);
 
 	template<int denom>
 	constexpr int deflate_radius(int numer) { return numer / denom; }
@@ -46,10 +46,11 @@ static inline void pass1(int src_w, int src_h, int size, int size1,
 	i16 const* a_buf, size_t a_stride, i16 thresh,
 	med_data* med_buf, size_t med_stride)
 {
-	multi_thread(src_h, [=](int thread_id, int thread_num) {
+	MultiThread::chunks rows{ multi_thread, src_h };
+	multi_thread(src_h, [=, &rows](int thread_id, int thread_num) {
 		int dst_w = src_w - 2 * size;
 
-		for (int y = thread_id; y < src_h; y += thread_num) {
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 			auto a_buf_y = a_buf + size * a_step + y * a_stride;
 			auto m_buf_y = med_buf + y * med_stride;
 
@@ -88,7 +89,7 @@ static inline void pass1(int src_w, int src_h, int size, int size1,
 template<size_t a_step>
 static inline void pass2(int src_w, int src_h, int size, int size1,
 	med_data const* med_buf, size_t med_stride,
-	i16* a_buf, size_t a_stride, i32 const* arc, void* cnt_buf)
+	i16* a_buf, size_t a_stride, i32 const* arc, void* cnt_buf, row_sink const* sink)
 {
 	struct fill_count {
 		int l, r;
@@ -167,6 +168,7 @@ static inline void pass2(int src_w, int src_h, int size, int size1,
 				if (m_buf_y->d <= size1) count->update(*m_buf_y, arc);
 				*a_buf_y = std::min(*a_buf_y, count->alpha());
 			}
+			if (sink != nullptr) sink->apply<a_step>(a_buf + y * a_stride, x0, x1, y);
 		}
 	});
 }
@@ -175,7 +177,7 @@ static inline void pass2(int src_w, int src_h, int size, int size1,
 Bounds bin2x::deflate(int src_w, int src_h,
 	i16 const* src_buf, bool src_colored, size_t src_stride, i16 thresh,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size2_sq)
+	void* heap, int size2_sq, row_sink const* sink)
 {
 	auto* const arc = reinterpret_cast<i32*>(heap);
 	arc[0] = arith::arc::quarter(size2_sq, &arc[1]);
@@ -190,7 +192,7 @@ Bounds bin2x::deflate(int src_w, int src_h,
 		(src_w, src_h, size, size1, src_buf, src_stride, thresh, med_buf, dst_w);
 
 	(dst_colored ? pass2<4> : pass2<1>)
-		(src_w, src_h, size, size1, med_buf, dst_w, dst_buf, dst_stride, arc, cnt_buf);
+		(src_w, src_h, size, size1, med_buf, dst_w, dst_buf, dst_stride, arc, cnt_buf, sink);
 
 	return { 0, 0, dst_w, src_h - 2 * size };
 }
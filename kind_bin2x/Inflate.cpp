@@ -131,7 +131,7 @@ static inline auto pass1(int src_w, int src_h, int size,
 template<size_t a_step>
 static inline auto pass2(int src_w, int src_h, int size,
 	med_data const* med_buf, size_t med_stride,
-	i16* a_buf, size_t a_stride, i32 const* arc)
+	i16* a_buf, size_t a_stride, i32 const* arc, row_sink const* sink)
 {
 	struct fill_count {
 		int u, l;
@@ -156,10 +156,11 @@ static inline auto pass2(int src_w, int src_h, int size,
 	};
 
 	int dst_h = src_h + 2 * size;
-	auto const bounds = multi_thread(dst_h, [=](int thread_id, int thread_num) {
+	MultiThread::chunks rows{ multi_thread, dst_h };
+	auto const bounds = multi_thread(dst_h, [=, &rows](int thread_id, int thread_num) {
 		int top = dst_h, bottom = -1;
 
-		for (int y = thread_id; y < dst_h; y += thread_num) {
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 			auto m_buf_y = med_buf + y * med_stride;
 			auto a_buf_y = a_buf + y * a_stride;
 
@@ -198,6 +199,7 @@ static inline auto pass2(int src_w, int src_h, int size,
 				count--;
 				*a_buf_x = count.alpha();
 			}
+			if (sink != nullptr) sink->apply<a_step>(a_buf_y, 0, src_w + 2 * size, y);
 		}
 
 		return std::pair{ top, bottom };
@@ -211,7 +213,7 @@ static inline auto pass2(int src_w, int src_h, int size,
 Bounds bin2x::inflate(int src_w, int src_h,
 	i16 const* src_buf, bool src_colored, size_t src_stride, i16 thresh,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size2_sq)
+	void* heap, int size2_sq, row_sink const* sink)
 {
 	auto* const arc = reinterpret_cast<i32*>(heap);
 	arc[0] = arith::arc::quarter(size2_sq, &arc[1]);
@@ -229,8 +231,10 @@ Bounds bin2x::inflate(int src_w, int src_h,
 	med_buf += left; dst_buf += left * (dst_colored ? 4 : 1);
 	src_w = right - left;
 
+	row_sink const sink_here = sink != nullptr ? sink->move(-left, 0) : row_sink{};
 	auto [top, bottom] = (dst_colored ? pass2<4> : pass2<1>)
-		(src_w, src_h, size, med_buf, med_stride, dst_buf, dst_stride, arc);
+		(src_w, src_h, size, med_buf, med_stride, dst_buf, dst_stride, arc,
+			sink != nullptr ? &sink_here : nullptr);
 
 	right += 2 * size;
 	return { left, top, right, bottom };
@@ -23,22 +23,27 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 using namespace Calculation;
 using mask = masking::mask;
 
-template<size_t src_step, size_t a_step>
-static inline void find_min(int src_w, int src_h, int size,
-	i16 const* src_buf, size_t src_stride,
-	mask const* mask_buf, size_t mask_stride,
-	i16* a_buf, size_t a_stride, i32 const* arc)
+// the sliding disc is swept back and forth along the "inner" axis,
+// and steps by one along the "outer" axis between the sweeps.
+// each thread takes a contiguous range along the outer axis,
+// and calls `line_done(o)` as soon as it finishes the line at `o`.
+// P: the precision of the source plane.
+template<class P>
+static inline void find_min_core(int dst_outer, int dst_inner, int size,
+	typename P::type const* src_buf, size_t src_outer, size_t src_inner,
+	mask const* mask_buf, size_t mask_outer, size_t mask_inner,
+	mask const* blk_buf, size_t blk_outer, size_t blk_inner,
+	i16* a_buf, size_t a_outer, size_t a_inner, i32 const* arc, auto&& line_done)
 {
 	// arc[i]: i ranges from -size to size.
 
-	int const dst_w = src_w - 2 * size, dst_h = src_h - 2 * size,
-		disk_area = 1 + 4 * (size + std::accumulate(arc + 1, arc + size + 1, 0));
+	int const disk_area = 1 + 4 * (size + std::accumulate(arc + 1, arc + size + 1, 0));
 #pragma warning(suppress : 6262) // allocating > 16 KiB on stack.
-	multi_thread(dst_w, [&](int thread_id, int thread_num)
+	multi_thread(dst_outer, [&](int thread_id, int thread_num)
 	{
 		// the buckets that count pixels at each alpha value (except alpha == full).
-		uint32_t bucket[max_alpha + 1]{}; // bucket[max_alpha] is simply ignored.
-		int curr_min = max_alpha;
+		uint32_t bucket[P::max + 1]{}; // bucket[P::max] is simply ignored.
+		int curr_min = P::max;
 		auto add = [&](int alpha) {
 			alpha = std::max(alpha, 0);
 			bucket[alpha]++;
@@ -49,106 +54,132 @@ static inline void find_min(int src_w, int src_h, int size,
 			bucket[alpha]--;
 		};
 		auto update_min = [&] {
-			while (curr_min < max_alpha && bucket[curr_min] == 0) curr_min++;
+			while (curr_min < P::max && bucket[curr_min] == 0) curr_min++;
 		};
 
-		int const x0 = dst_w * thread_id / thread_num, x1 = dst_w * (thread_id + 1) / thread_num;
+		int const o0 = dst_outer * thread_id / thread_num, o1 = dst_outer * (thread_id + 1) / thread_num;
 
 		// first state of buckets.
-		switch (mask_buf[x0]) {
+		switch (mask_buf[o0 * mask_outer]) {
 		case mask::zero: bucket[0] = disk_area - 2 * size - 1; curr_min = 0; break;
-		case mask::full: curr_min = max_alpha; break;
+		case mask::full: curr_min = P::max; break;
 		case mask::gray:
 		default:
-			for (int dy = -size; dy <= size; dy++) {
-				int secant = arc[dy];
-				for (int dx = -secant; dx <= secant; dx++)
-					add(src_buf[(x0 + dx + size) * src_step + (dy + size) * src_stride]);
+			for (int di = -size; di <= size; di++) {
+				int secant = arc[di];
+				for (int d_o = -secant; d_o <= secant; d_o++)
+					add(src_buf[(o0 + d_o + size) * src_outer + (di + size) * src_inner]);
 			}
 			break;
 		}
 
-		bool t2b = true;
-		auto s_buf_pt = src_buf + (x0 + size) * src_step + size * src_stride;
-		auto m_buf_pt = mask_buf + x0;
-		auto a_buf_pt = a_buf + x0 * a_step;
-		for (int x = x0; /*x < x1*/; x++, t2b ^= true,
-			s_buf_pt += src_step, m_buf_pt++, a_buf_pt += a_step) {
+		bool forward = true;
+		auto s_buf_pt = src_buf + (o0 + size) * src_outer + size * src_inner;
+		auto m_buf_pt = mask_buf + o0 * mask_outer;
+		auto a_buf_pt = a_buf + o0 * a_outer;
+		for (int o = o0; /*o < o1*/; o++, forward ^= true,
+			s_buf_pt += src_outer, m_buf_pt += mask_outer, a_buf_pt += a_outer) {
 			// aggregate the points on the "incoming arc".
-			if (x > x0) {
+			if (o > o0) {
 				switch (*m_buf_pt) {
 				case mask::zero: curr_min = 0; break;
 				case mask::full: break; // ignore full alpha.
 				case mask::gray:
 				default:
-					for (int dy = -size; dy <= size; dy++)
-						add(s_buf_pt[+arc[dy] * src_step + dy * src_stride]);
+					for (int di = -size; di <= size; di++)
+						add(s_buf_pt[+arc[di] * src_outer + di * src_inner]);
 					break;
 				}
 			}
 
-			if (t2b) {
-				for (int y = 0; y < dst_h; y++,
-					s_buf_pt += src_stride, m_buf_pt += mask_stride, a_buf_pt += a_stride) {
+			auto const b_buf_o = blk_buf + (o >> masking::log2_blk_size) * blk_outer;
+			if (forward) {
+				for (int i = 0; i < dst_inner; i++,
+					s_buf_pt += src_inner, m_buf_pt += mask_inner, a_buf_pt += a_inner) {
+					// skip the whole block if it's uniform.
+					if ((i & (masking::blk_size - 1)) == 0) {
+						if (auto b = b_buf_o[(i >> masking::log2_blk_size) * blk_inner]; b != mask::gray) {
+							int const n = std::min(masking::blk_size, dst_inner - i) - 1;
+							curr_min = b == mask::full ? P::max : 0;
+							masking::fill_run(a_buf_pt, a_inner, n + 1, P::to_alpha(curr_min));
+
+							i += n; s_buf_pt += n * src_inner; m_buf_pt += n * mask_inner; a_buf_pt += n * a_inner;
+							continue;
+						}
+					}
+
 					switch (*m_buf_pt) {
-					case mask::zero: *a_buf_pt = curr_min = 0; continue;
-					case mask::full: *a_buf_pt = curr_min = max_alpha; continue;
+					case mask::zero: curr_min = 0; *a_buf_pt = 0; continue;
+					case mask::full: curr_min = P::max; *a_buf_pt = max_alpha; continue;
 					}
 
 					// aggregate the points on the "incoming arc".
-					if (y > 0) {
-						for (int dx = -size; dx <= size; dx++)
-							add(s_buf_pt[dx * src_step + arc[dx] * src_stride]);
+					if (i > 0) {
+						for (int d_o = -size; d_o <= size; d_o++)
+							add(s_buf_pt[d_o * src_outer + arc[d_o] * src_inner]);
 					}
 
 					// write the alpha value.
 					update_min();
-					*a_buf_pt = curr_min;
+					*a_buf_pt = P::to_alpha(curr_min);
 
 					// aggregate the points on the "outgoing arc".
-					if (y < dst_h - 1) {
-						for (int dx = -size; dx <= size; dx++)
-							pop(s_buf_pt[dx * src_step - arc[dx] * src_stride]);
+					if (i < dst_inner - 1) {
+						for (int d_o = -size; d_o <= size; d_o++)
+							pop(s_buf_pt[d_o * src_outer - arc[d_o] * src_inner]);
 					}
 				}
-				s_buf_pt -= src_stride; m_buf_pt -= mask_stride; a_buf_pt -= a_stride;
+				s_buf_pt -= src_inner; m_buf_pt -= mask_inner; a_buf_pt -= a_inner;
 			}
 			else {
-				for (int y = dst_h - 1; y >= 0; y--,
-					s_buf_pt -= src_stride, m_buf_pt -= mask_stride, a_buf_pt -= a_stride) {
+				for (int i = dst_inner - 1; i >= 0; i--,
+					s_buf_pt -= src_inner, m_buf_pt -= mask_inner, a_buf_pt -= a_inner) {
+					// skip the whole block if it's uniform.
+					if ((i & (masking::blk_size - 1)) == masking::blk_size - 1 || i == dst_inner - 1) {
+						if (auto b = b_buf_o[(i >> masking::log2_blk_size) * blk_inner]; b != mask::gray) {
+							int const n = i & (masking::blk_size - 1);
+							curr_min = b == mask::full ? P::max : 0;
+							masking::fill_run(a_buf_pt - n * a_inner, a_inner, n + 1, P::to_alpha(curr_min));
+
+							i -= n; s_buf_pt -= n * src_inner; m_buf_pt -= n * mask_inner; a_buf_pt -= n * a_inner;
+							continue;
+						}
+					}
+
 					switch (*m_buf_pt) {
-					case mask::zero: *a_buf_pt = curr_min = 0; continue;
-					case mask::full: *a_buf_pt = curr_min = max_alpha; continue;
+					case mask::zero: curr_min = 0; *a_buf_pt = 0; continue;
+					case mask::full: curr_min = P::max; *a_buf_pt = max_alpha; continue;
 					}
 
 					// aggregate the points on the "incoming arc".
-					if (y < dst_h - 1) {
-						for (int dx = -size; dx <= size; dx++)
-							add(s_buf_pt[dx * src_step - arc[dx] * src_stride]);
+					if (i < dst_inner - 1) {
+						for (int d_o = -size; d_o <= size; d_o++)
+							add(s_buf_pt[d_o * src_outer - arc[d_o] * src_inner]);
 					}
 
 					// write the alpha value.
 					update_min();
-					*a_buf_pt = curr_min;
+					*a_buf_pt = P::to_alpha(curr_min);
 
 					// aggregate the points on the "outgoing arc".
-					if (y > 0) {
-						for (int dx = -size; dx <= size; dx++)
-							pop(s_buf_pt[dx * src_step + arc[dx] * src_stride]);
+					if (i > 0) {
+						for (int d_o = -size; d_o <= size; d_o++)
+							pop(s_buf_pt[d_o * src_outer + arc[d_o] * src_inner]);
 					}
 				}
-				s_buf_pt += src_stride; m_buf_pt += mask_stride; a_buf_pt += a_stride;
+				s_buf_pt += src_inner; m_buf_pt += mask_inner; a_buf_pt += a_inner;
 			}
+			line_done(o);
 
 			// aggregate the points on the "outgoing arc".
-			if (x < x1 - 1) {
+			if (o < o1 - 1) {
 				switch (*m_buf_pt) {
 				case mask::zero: break;
 				case mask::full: break; // ignore full alpha.
 				case mask::gray:
 				default:
-					for (int dy = -size; dy <= size; dy++)
-						pop(s_buf_pt[-arc[dy] * src_step + dy * src_stride]);
+					for (int di = -size; di <= size; di++)
+						pop(s_buf_pt[-arc[di] * src_outer + di * src_inner]);
 					break;
 				}
 			}
@@ -157,11 +188,40 @@ static inline void find_min(int src_w, int src_h, int size,
 	});
 }
 
+template<class P, size_t src_step, size_t a_step>
+static inline void find_min(int src_w, int src_h, int size,
+	typename P::type const* src_buf, size_t src_stride,
+	mask const* mask_buf, size_t mask_stride,
+	mask const* blk_buf, size_t blk_stride,
+	i16* a_buf, size_t a_stride, i32 const* arc, row_sink const* sink)
+{
+	int const dst_w = src_w - 2 * size, dst_h = src_h - 2 * size;
+
+	// sweeping along rows touches memory contiguously, which is much friendlier to caches.
+	// sweep along columns only when there are too few rows to share among the threads,
+	// unless `sink` needs the rows.
+	// the disc is symmetric, so results are identical either way.
+	if (sink != nullptr || dst_h >= multi_thread.num_threads() || dst_h >= dst_w)
+		find_min_core<P>(dst_h, dst_w, size,
+			src_buf, src_stride, src_step,
+			mask_buf, mask_stride, 1,
+			blk_buf, blk_stride, 1,
+			a_buf, a_stride, a_step, arc, [&](int y) {
+				if (sink != nullptr) sink->apply<a_step>(a_buf + y * a_stride, 0, dst_w, y);
+			});
+	else find_min_core<P>(dst_w, dst_h, size,
+			src_buf, src_step, src_stride,
+			mask_buf, 1, mask_stride,
+			blk_buf, 1, blk_stride,
+			a_buf, a_step, a_stride, arc, [](int) {});
+}
+
 
+template<class P>
 inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 	int src_w, int src_h,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace masking::deflation;
 
@@ -176,6 +236,7 @@ inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 	auto [src_buf, src_stride, top, bottom] = alloc_and_mask_h(size, mask_buf, mask_stride);
 	if (top >= bottom - 2 * size) return { 0,0,0,0 };
 
+	auto* const blk_buf = mask_buf + mask_stride * src_h;
 	mask_buf += top * mask_stride;
 	src_buf += top * src_stride;
 	dst_buf += top * dst_stride;
@@ -190,9 +251,15 @@ inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 	dst_buf += left * (dst_colored ? 4 : 1);
 	src_w = right - left + 2 * size;
 
-	(dst_colored ? find_min<1, 4> : find_min<1, 1>)
+	size_t const blk_stride = masking::blk_stride(right - left);
+	masking::summarize(right - left, bottom - top, mask_buf, mask_stride, blk_buf, blk_stride);
+	if (keep_hint != nullptr) keep_hint->keep(right - left, bottom - top, blk_buf, blk_stride);
+
+	row_sink const sink_here = sink != nullptr ? sink->move(-left, -top) : row_sink{};
+	(dst_colored ? find_min<P, 1, 4> : find_min<P, 1, 1>)
 		(src_w, src_h, size, src_buf, src_stride,
-			mask_buf, mask_stride, dst_buf, dst_stride, arc + size);
+			mask_buf, mask_stride, blk_buf, blk_stride, dst_buf, dst_stride, arc + size,
+			sink != nullptr ? &sink_here : nullptr);
 
 	return { left, top, right, bottom };
 }
@@ -200,27 +267,32 @@ inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 Bounds max::deflate(int src_w, int src_h,
 	i16* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint const* known)
 {
 	using namespace masking::deflation;
-	return deflate_common([&](int size, mask* mask_buf, size_t mask_stride) {
-		auto [top, bottom] = mask_h_alpha<0>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride);
+	return deflate_common<alpha12>([&](int size, mask* mask_buf, size_t mask_stride) {
+		auto [top, bottom] = mask_h_alpha<0>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, known);
 		return std::tuple{ src_buf, src_stride, top, bottom };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq, nullptr, nullptr);
 }
 
+template<class P>
 Bounds max::deflate(int src_w, int src_h,
 	ExEdit::PixelYCA const* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq, void* alpha_space)
+	void* heap, int size_sq, void* alpha_space, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace masking::deflation;
-	return deflate_common([&](int size, mask* mask_buf, size_t mask_stride) {
-		i16* med_buf = reinterpret_cast<i16*>(alpha_space);
+	return deflate_common<P>([&](int size, mask* mask_buf, size_t mask_stride) {
+		auto* med_buf = reinterpret_cast<typename P::type*>(alpha_space);
 		size_t med_stride = (src_w + 1) & (-2);
-		auto [top, bottom] = mask_h_color<0>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride,
+		auto [top, bottom] = mask_h_color<0, P>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride,
 			med_buf, med_stride);
 		return std::tuple{ med_buf, med_stride, top, bottom };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq, keep_hint, sink);
 }
+template Bounds max::deflate<alpha12>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, void*, int, void*, masking::hint*, row_sink const*);
+template Bounds max::deflate<alpha8>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, void*, int, void*, masking::hint*, row_sink const*);
 
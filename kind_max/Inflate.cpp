@@ -22,20 +22,33 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 using namespace Calculation;
 using mask = masking::mask;
 
-template<size_t src_step, size_t a_step>
+// P: the precision of the source plane.
+// R: the size fixed at compile time, or 0 if it's not.
+template<class P, int R, size_t src_step, size_t a_step>
 static inline void find_max(int src_w, int src_h, int size,
-	i16 const* src_buf, size_t src_stride,
+	typename P::type const* src_buf, size_t src_stride,
 	mask const* mask_buf, size_t mask_stride,
-	i16* a_buf, size_t a_stride, i32 const* arc)
+	mask const* blk_buf, size_t blk_stride,
+	i16* a_buf, size_t a_stride, i32 const* arc, row_sink const* sink)
 {
 	// arc[i]: i ranges from -size to size.
 
+	// offsets to the points on the whole arcs, for the unrolled loops.
+	ptrdiff_t ofs_in[2 * R + 1], ofs_out[2 * R + 1];
+	if constexpr (R > 0) {
+		for (int dy = -R; dy <= R; dy++) {
+			ofs_in[R + dy] = +arc[dy] * static_cast<ptrdiff_t>(src_step) + dy * static_cast<ptrdiff_t>(src_stride);
+			ofs_out[R + dy] = -arc[dy] * static_cast<ptrdiff_t>(src_step) + dy * static_cast<ptrdiff_t>(src_stride);
+		}
+	}
+
 	int dst_w = src_w + 2 * size, dst_h = src_h + 2 * size;
+	MultiThread::chunks rows{ multi_thread, dst_h };
 #pragma warning(suppress : 6262) // allocating > 16 KiB on stack.
 	multi_thread(dst_h, [&](int thread_id, int thread_num)
 	{
 		// the buckets that count pixels at each alpha value (except alpha == 0).
-		uint32_t bucket[max_alpha + 1]{}; // bucket[0] is simply ignored.
+		uint32_t bucket[P::max + 1]{}; // bucket[0] is simply ignored.
 		int curr_max = 0;
 		auto add = [&](int alpha) {
 			bucket[alpha]++;
@@ -48,18 +61,31 @@ static inline void find_max(int src_w, int src_h, int size,
 			while (curr_max > 0 && bucket[curr_max] == 0) curr_max--;
 		};
 
-		for (int y = thread_id; y < dst_h; y += thread_num) {
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 			auto s_buf_pt = src_buf - size * src_step + (y - size) * src_stride;
 			auto m_buf_pt = mask_buf + y * mask_stride;
 			auto a_buf_pt = a_buf + y * a_stride;
+			auto b_buf_y = blk_buf + (y >> masking::log2_blk_size) * blk_stride;
 
 			int const dy_min = std::max(-size, size - y), dy_max = std::min(size, dst_h - size - 1 - y);
 			for (int x = 0; x < dst_w; x++,
 				s_buf_pt += src_step, m_buf_pt++, a_buf_pt += a_step) {
 
+				// skip the whole block if it's uniform.
+				if ((x & (masking::blk_size - 1)) == 0) {
+					if (auto b = b_buf_y[x >> masking::log2_blk_size]; b != mask::gray) {
+						int const n = std::min(masking::blk_size, dst_w - x) - 1;
+						curr_max = b == mask::full ? P::max : 0;
+						masking::fill_run(a_buf_pt, a_step, n + 1, P::to_alpha(curr_max));
+
+						x += n; s_buf_pt += n * src_step; m_buf_pt += n; a_buf_pt += n * a_step;
+						continue;
+					}
+				}
+
 				switch (*m_buf_pt) {
-				case mask::zero: *a_buf_pt = curr_max = 0; continue;
-				case mask::full: *a_buf_pt = curr_max = max_alpha; continue;
+				case mask::zero: curr_max = 0; *a_buf_pt = 0; continue;
+				case mask::full: curr_max = P::max; *a_buf_pt = max_alpha; continue;
 				}
 
 				// aggregate the points on the "incoming arc".
@@ -70,7 +96,9 @@ static inline void find_max(int src_w, int src_h, int size,
 						dy0 = std::max(-c, dy_min);
 						dy1 = std::min(+c, dy_max);
 					}
-					if (x < dst_w - 2 * size) {
+					if (R > 0 && dy0 == -R && dy1 == R && x < dst_w - 2 * R)
+						arith::arc::unroll<R>([&](int dy) { add(s_buf_pt[ofs_in[R + dy]]); });
+					else if (x < dst_w - 2 * size) {
 						for (int dy = dy0; dy <= dy1; dy++)
 							add(s_buf_pt[+arc[dy] * src_step + dy * src_stride]);
 					}
@@ -86,7 +114,7 @@ static inline void find_max(int src_w, int src_h, int size,
 
 				// write the alpha value.
 				update_max();
-				*a_buf_pt = curr_max;
+				*a_buf_pt = P::to_alpha(curr_max);
 
 				// aggregate the points on the "outgoing arc".
 				if (x >= size) {
@@ -96,7 +124,9 @@ static inline void find_max(int src_w, int src_h, int size,
 						dy0 = std::max(-c, dy_min);
 						dy1 = std::min(+c, dy_max);
 					}
-					if (x >= 2 * size) {
+					if (R > 0 && dy0 == -R && dy1 == R && x >= 2 * R)
+						arith::arc::unroll<R>([&](int dy) { pop(s_buf_pt[ofs_out[R + dy]]); });
+					else if (x >= 2 * size) {
 						for (int dy = dy0; dy <= dy1; dy++)
 							pop(s_buf_pt[-arc[dy] * src_step + dy * src_stride]);
 					}
@@ -110,15 +140,17 @@ static inline void find_max(int src_w, int src_h, int size,
 					}
 				}
 			}
+			if (sink != nullptr) sink->apply<a_step>(a_buf + y * a_stride, 0, dst_w, y);
 		}
 	});
 }
 
 
+template<class P>
 inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 	int src_w, int src_h,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace masking::inflation;
 
@@ -138,6 +170,8 @@ inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 	dst_buf += left * (dst_colored ? 4 : 1);
 	src_w = right - left;
 
+	auto* const blk_buf = mask_buf - left + mask_stride * (src_h + 2 * size);
+
 	auto [top, bottom] = mask_h(src_w, src_h, size, mask_buf, mask_stride);
 
 	right += 2 * size;
@@ -146,9 +180,17 @@ inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 	dst_buf += top * dst_stride;
 	src_h = bottom - top - 2 * size;
 
-	(dst_colored ? find_max<1, 4> : find_max<1, 1>)
-		(src_w, src_h, size, src_buf, src_stride,
-			mask_buf, mask_stride, dst_buf, dst_stride, arc + size);
+	size_t const blk_stride = masking::blk_stride(src_w + 2 * size);
+	masking::summarize(src_w + 2 * size, src_h + 2 * size, mask_buf, mask_stride, blk_buf, blk_stride);
+	if (keep_hint != nullptr) keep_hint->keep(src_w + 2 * size, src_h + 2 * size, blk_buf, blk_stride);
+
+	row_sink const sink_here = sink != nullptr ? sink->move(-left, -top) : row_sink{};
+	arith::arc::dispatch(size, [&]<int R>(std::integral_constant<int, R>) {
+		(dst_colored ? find_max<P, R, 1, 4> : find_max<P, R, 1, 1>)
+			(src_w, src_h, size, src_buf, src_stride,
+				mask_buf, mask_stride, blk_buf, blk_stride, dst_buf, dst_stride, arc + size,
+				sink != nullptr ? &sink_here : nullptr);
+	});
 
 	return { left, top, right, bottom };
 }
@@ -156,28 +198,33 @@ inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 Bounds max::inflate(int src_w, int src_h,
 	i16* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint const* known, row_sink const* sink)
 {
 	using namespace masking::inflation;
-	return inflate_common([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
-		auto [left, right] = mask_v_alpha(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap);
+	return inflate_common<alpha12>([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
+		auto [left, right] = mask_v_alpha(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap, known);
 		return std::tuple{ src_buf, src_stride, left, right };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq, nullptr, sink);
 }
 
+template<class P>
 Bounds max::inflate(int src_w, int src_h,
 	ExEdit::PixelYCA const* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq, void* alpha_space)
+	void* heap, int size_sq, void* alpha_space, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace masking::inflation;
-	return inflate_common([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
-		i16* med_buf = reinterpret_cast<i16*>(alpha_space);
+	return inflate_common<P>([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
+		auto* med_buf = reinterpret_cast<typename P::type*>(alpha_space);
 		size_t med_stride = (src_w + 1) & (-2);
-		auto [left, right] = mask_v_color(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap,
+		auto [left, right] = mask_v_color<P>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap,
 			med_buf, med_stride);
 
 		return std::tuple{ med_buf, med_stride, left, right };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq, keep_hint, sink);
 }
+template Bounds max::inflate<alpha12>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, void*, int, void*, masking::hint*, row_sink const*);
+template Bounds max::inflate<alpha8>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, void*, int, void*, masking::hint*, row_sink const*);
 
@@ -13,7 +13,10 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 #pragma once
 
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <tuple>
+#include <vector>
 
 #include <exedit/pixel.hpp>
 #include "../multi_thread.hpp"
@@ -27,15 +30,103 @@ namespace Calculation::masking
 		full, // all pixels nearby are fully opaque.
 	};
 	static_assert(sizeof(mask) == 1);
+
+	// coarse summary of the mask, each element of which tells whether
+	// the block of blk_size x blk_size pixels is entirely zero, entirely full, or mixed (gray).
+	constexpr int log2_blk_size = 4, blk_size = 1 << log2_blk_size;
+	constexpr int blk_count(int len) { return (len + (blk_size - 1)) >> log2_blk_size; }
+	constexpr size_t blk_stride(int w) { return (blk_count(w) + 3) & (-4); }
+	constexpr size_t summary_size(int w, int h) {
+		return sizeof(mask) * blk_stride(w) * blk_count(h);
+	}
+
+	inline void summarize(int w, int h,
+		mask const* mask_buf, size_t mask_stride,
+		mask* blk_buf, size_t blk_stride)
+	{
+		int const blk_w = blk_count(w), blk_h = blk_count(h);
+		multi_thread(blk_h, [&](int thread_id, int thread_num) {
+			for (int by = thread_id; by < blk_h; by += thread_num) {
+				int const y0 = by << log2_blk_size, y1 = std::min(y0 + blk_size, h);
+				auto b_buf_y = blk_buf + by * blk_stride;
+				auto m_buf_y = mask_buf + y0 * mask_stride;
+
+				for (int bx = 0; bx < blk_w; bx++) b_buf_y[bx] = m_buf_y[bx << log2_blk_size];
+				for (int y = y0; y < y1; y++, m_buf_y += mask_stride) {
+					for (int bx = 0; bx < blk_w; bx++) {
+						if (b_buf_y[bx] == mask::gray) continue;
+
+						int const x0 = bx << log2_blk_size, x1 = std::min(x0 + blk_size, w);
+						for (int x = x0; x < x1; x++) {
+							if (m_buf_y[x] != b_buf_y[bx]) {
+								b_buf_y[bx] = mask::gray;
+								break;
+							}
+						}
+					}
+				}
+			}
+		});
+	}
+
+	// the summary of the result of a pass, kept for the next pass on that result,
+	// so the blocks known to be uniform are classified without looking into the alpha values.
+	// the block at (0, 0) starts at the top-left corner of the bounds the pass returned.
+	struct hint {
+		std::vector<mask> blk{};
+		size_t stride = 0;
+		int w = 0, h = 0; // counted in blocks, 0 if nothing is kept.
+
+		void keep(int len_w, int len_h, mask const* blk_buf, size_t blk_stride)
+		{
+			w = blk_count(len_w); h = blk_count(len_h); stride = blk_stride;
+			blk.assign(blk_buf, blk_buf + stride * h);
+		}
+		void clear() { w = h = 0; }
+
+		// the block containing the pixel at (x, y).
+		mask at(int x, int y) const
+		{
+			int const bx = x >> log2_blk_size, by = y >> log2_blk_size;
+			return bx < w && by < h ? blk[by * stride + bx] : mask::gray;
+		}
+		// the end of the run of blocks in the row, of the same kind as the one containing (x, y).
+		// returns at most `end`.
+		int run_end(int x, int y, int end) const
+		{
+			auto const b = at(x, y);
+			int bx = (x >> log2_blk_size) + 1;
+			if (int const by = y >> log2_blk_size; by < h) {
+				auto const* b_buf = blk.data() + by * stride;
+				for (int bx_end = std::min(w, blk_count(end)); bx < bx_end && b_buf[bx] == b; bx++);
+			}
+			return std::min(bx << log2_blk_size, end);
+		}
+	};
+
+	// the alpha value of a pixel, clamped and converted into the precision `P`.
+	template<class P>
+	constexpr typename P::type alpha_of(ExEdit::PixelYCA const& px)
+	{
+		return P::from_alpha(std::clamp<int>(px.a, 0, max_alpha));
+	}
+
+	// fills a run of `n` alpha values in a row, used when skipping a uniform block.
+	inline void fill_run(i16* a_buf, size_t a_step, int n, i16 val)
+	{
+		if (a_step == 1) std::fill_n(a_buf, n, val);
+		else for (int x = n; --x >= 0; a_buf += a_step) *a_buf = val;
+	}
 }
 
 namespace Calculation::masking::inflation
 {
 	// heap must be large enough to contain 2*sizeof(i32)*src_w bytes.
+	template<class P = alpha12>
 	inline auto mask_v_color(int src_w, int src_h, int size,
 		ExEdit::PixelYCA const* src_buf, size_t src_stride,
 		mask* mask_buf, size_t mask_stride, void* heap,
-		i16* a_buf, size_t a_stride)
+		typename P::type* a_buf, size_t a_stride)
 	{
 		struct Cnt { i32 i, o; };
 		auto cnt0 = reinterpret_cast<Cnt*>(heap);
@@ -59,11 +150,11 @@ namespace Calculation::masking::inflation
 				auto s_buf_x = s_buf_x0; auto m_buf_x = m_buf_x0; auto d_buf_x = d_buf_x0;
 				auto cnt = cnt_x0;
 				for (int x = x1 - x0; --x >= 0; s_buf_x++, m_buf_x++, d_buf_x++, cnt++) {
-					*d_buf_x = s_buf_x->a;
+					*d_buf_x = alpha_of<P>(*s_buf_x);
 
 					--cnt->o; --cnt->i;
-					if (*d_buf_x > 0) cnt->o = 2 * size; else *d_buf_x = 0;
-					if (*d_buf_x < max_alpha) cnt->i = 2 * size; else *d_buf_x = max_alpha;
+					if (*d_buf_x > 0) cnt->o = 2 * size;
+					if (*d_buf_x < P::max) cnt->i = 2 * size;
 					*m_buf_x = cnt->o < 0 ? mask::zero :
 						cnt->i < 0 ? mask::full : mask::gray;
 				}
@@ -111,10 +202,13 @@ namespace Calculation::masking::inflation
 		return unite_interval_alt<int>(bounds);
 	}
 	// heap must be large enough to contain 2*sizeof(i32)*src_w bytes.
+	// `known` optionally tells the blocks of `a_buf` known to be uniform.
 	inline auto mask_v_alpha(int src_w, int src_h, int size,
 		i16* a_buf, size_t a_stride,
-		mask* mask_buf, size_t mask_stride, void* heap)
+		mask* mask_buf, size_t mask_stride, void* heap, hint const* known = nullptr)
 	{
+		if (known != nullptr && known->w <= 0) known = nullptr;
+
 		struct Cnt { i32 i, o; };
 		auto cnt0 = reinterpret_cast<Cnt*>(heap);
 
@@ -130,15 +224,31 @@ namespace Calculation::masking::inflation
 				for (int x = x1 - x0; --x >= 0; cnt++) *cnt = { 2 * size, 0 };
 			}
 
-			for (int y = src_h; --y >= 0; a_buf_x0 += a_stride, m_buf_x0 += mask_stride) {
+			for (int y = 0; y < src_h; y++, a_buf_x0 += a_stride, m_buf_x0 += mask_stride) {
 				auto a_buf_x = a_buf_x0; auto m_buf_x = m_buf_x0;
 				auto cnt = cnt_x0;
-				for (int x = x1 - x0; --x >= 0; a_buf_x++, m_buf_x++, cnt++) {
-					--cnt->o; --cnt->i;
-					if (*a_buf_x > 0) cnt->o = 2 * size; else *a_buf_x = 0;
-					if (*a_buf_x < max_alpha) cnt->i = 2 * size; else *a_buf_x = max_alpha;
-					*m_buf_x = cnt->o < 0 ? mask::zero :
-						cnt->i < 0 ? mask::full : mask::gray;
+				for (int x = x0, xb; x < x1; x = xb) {
+					auto const b = known != nullptr ? known->at(x, y) : mask::gray;
+					xb = known != nullptr ? known->run_end(x, y, x1) : x1;
+					if (b == mask::gray) {
+						for (int i = xb - x; --i >= 0; a_buf_x++, m_buf_x++, cnt++) {
+							--cnt->o; --cnt->i;
+							if (*a_buf_x > 0) cnt->o = 2 * size; else *a_buf_x = 0;
+							if (*a_buf_x < max_alpha) cnt->i = 2 * size; else *a_buf_x = max_alpha;
+							*m_buf_x = cnt->o < 0 ? mask::zero :
+								cnt->i < 0 ? mask::full : mask::gray;
+						}
+					}
+					else {
+						// the block is known uniform, either 0 or max_alpha.
+						bool const full = b == mask::full;
+						for (int i = xb - x; --i >= 0; a_buf_x++, m_buf_x++, cnt++) {
+							if (full) { cnt->o = 2 * size; --cnt->i; }
+							else { --cnt->o; cnt->i = 2 * size; }
+							*m_buf_x = cnt->o < 0 ? mask::zero :
+								cnt->i < 0 ? mask::full : mask::gray;
+						}
+					}
 				}
 			}
 			for (int y = 2 * size; --y >= 0; m_buf_x0 += mask_stride) {
@@ -188,10 +298,11 @@ namespace Calculation::masking::inflation
 		mask* mask_buf, size_t mask_stride)
 	{
 		auto dst_h = src_h + 2 * size;
+		MultiThread::chunks rows{ multi_thread, dst_h };
 		auto bounds = multi_thread(dst_h, [&](int thread_id, int thread_num) {
 			int top = dst_h, bottom = -1;
 
-			for (int y = thread_id; y < dst_h; y += thread_num) {
+			for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 				auto m_buf_y = mask_buf + y * mask_stride;
 
 				int cnt_o = 0, cnt_i = 2 * size;
@@ -224,24 +335,23 @@ namespace Calculation::masking::inflation
 namespace Calculation::masking::deflation
 {
 	// diff_size == size_mask - size_canvas, >= 0 (either 0 or 1)
-	template<int diff_size>
+	template<int diff_size, class P = alpha12>
 	inline auto mask_h_color(int src_w, int src_h, int size_mask,
 		ExEdit::PixelYCA const* src_buf, size_t src_stride,
 		mask* mask_buf, size_t mask_stride,
-		i16* a_buf, size_t a_stride)
+		typename P::type* a_buf, size_t a_stride)
 	{
 		// has a second task to copy alpha values to a_buf
 		// --- those values are referred so many times in later processes
 		//     that it seems to be faster if they are placed within a compact space.
 
-		using Calculation::max_alpha;
-
 		int const inner_w1 = 2 * size_mask - diff_size,
 			inner_w2 = src_w - inner_w1;
+		MultiThread::chunks rows{ multi_thread, src_h };
 		auto bounds = multi_thread(src_h, [&](int thread_id, int thread_num) {
 			int top = src_h, bottom = -1;
 
-			for (int y = thread_id; y < src_h; y += thread_num) {
+			for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 				auto s_buf_y = src_buf + y * src_stride;
 				auto m_buf_y = mask_buf + y * mask_stride;
 				auto d_buf_y = a_buf + y * a_stride;
@@ -253,18 +363,18 @@ namespace Calculation::masking::deflation
 
 				int cnt_o = 0, cnt_i = 2 * size_mask;
 				for (int x = inner_w1; --x >= 0; s_buf_y++, d_buf_y++) {
-					*d_buf_y = s_buf_y->a;
+					*d_buf_y = alpha_of<P>(*s_buf_y);
 
 					cnt_o--; cnt_i--;
-					if (*d_buf_y > 0) cnt_o = 2 * size_mask; else *d_buf_y = 0;
-					if (*d_buf_y < max_alpha) cnt_i = 2 * size_mask; else *d_buf_y = max_alpha;
+					if (*d_buf_y > 0) cnt_o = 2 * size_mask;
+					if (*d_buf_y < P::max) cnt_i = 2 * size_mask;
 				}
 				for (int x = inner_w2; --x >= 0; s_buf_y++, m_buf_y++, d_buf_y++) {
-					*d_buf_y = s_buf_y->a;
+					*d_buf_y = alpha_of<P>(*s_buf_y);
 
 					cnt_o--; cnt_i--;
-					if (*d_buf_y > 0) cnt_o = 2 * size_mask; else *d_buf_y = 0;
-					if (*d_buf_y < max_alpha) cnt_i = 2 * size_mask; else *d_buf_y = max_alpha;
+					if (*d_buf_y > 0) cnt_o = 2 * size_mask;
+					if (*d_buf_y < P::max) cnt_i = 2 * size_mask;
 					*m_buf_y = cnt_o < 0 ? mask::zero :
 						cnt_i < 0 ? mask::full : mask::gray;
 				}
@@ -290,19 +400,22 @@ namespace Calculation::masking::deflation
 		return unite_interval_alt<int>(bounds);
 	}
 	// diff_size == size_mask - size_canvas, >= 0 (either 0 or 1)
+	// `known` optionally tells the blocks of `a_buf` known to be uniform.
 	template<int diff_size>
 	inline auto mask_h_alpha(int src_w, int src_h, int size_mask,
 		i16* a_buf, size_t a_stride,
-		mask* mask_buf, size_t mask_stride)
+		mask* mask_buf, size_t mask_stride, hint const* known = nullptr)
 	{
 		using Calculation::max_alpha;
+		if (known != nullptr && known->w <= 0) known = nullptr;
 
 		int const inner_w1 = 2 * size_mask - diff_size,
 			inner_w2 = src_w - inner_w1;
+		MultiThread::chunks rows{ multi_thread, src_h };
 		auto bounds = multi_thread(src_h, [&](int thread_id, int thread_num) {
 			int top = src_h, bottom = -1;
 
-			for (int y = thread_id; y < src_h; y += thread_num) {
+			for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 				auto s_buf_y = a_buf + y * a_stride;
 				auto m_buf_y = mask_buf + y * mask_stride;
 
@@ -312,18 +425,42 @@ namespace Calculation::masking::deflation
 				}
 
 				int cnt_o = 0, cnt_i = 2 * size_mask;
-				for (int x = inner_w1; --x >= 0; s_buf_y++) {
-					cnt_o--; cnt_i--;
-					if (*s_buf_y > 0) cnt_o = 2 * size_mask; else *s_buf_y = 0;
-					if (*s_buf_y < max_alpha) cnt_i = 2 * size_mask; else *s_buf_y = max_alpha;
-				}
-				for (int x = inner_w2; --x >= 0; s_buf_y++, m_buf_y++) {
-					cnt_o--; cnt_i--;
-					if (*s_buf_y > 0) cnt_o = 2 * size_mask; else *s_buf_y = 0;
-					if (*s_buf_y < max_alpha) cnt_i = 2 * size_mask; else *s_buf_y = max_alpha;
-					*m_buf_y = cnt_o < 0 ? mask::zero :
-						cnt_i < 0 ? mask::full : mask::gray;
+				for (int x = 0, xb; x < src_w; x = xb) {
+					auto const b = known != nullptr ? known->at(x, y) : mask::gray;
+					xb = known != nullptr ? known->run_end(x, y, src_w) : src_w;
+					int const xm = std::clamp(inner_w1, x, xb);
+					if (b == mask::gray) {
+						auto s_buf_x = s_buf_y + x;
+						for (int i = xm - x; --i >= 0; s_buf_x++) {
+							cnt_o--; cnt_i--;
+							if (*s_buf_x > 0) cnt_o = 2 * size_mask; else *s_buf_x = 0;
+							if (*s_buf_x < max_alpha) cnt_i = 2 * size_mask; else *s_buf_x = max_alpha;
+						}
+						auto m_buf_x = m_buf_y + (xm - inner_w1);
+						for (int i = xb - xm; --i >= 0; s_buf_x++, m_buf_x++) {
+							cnt_o--; cnt_i--;
+							if (*s_buf_x > 0) cnt_o = 2 * size_mask; else *s_buf_x = 0;
+							if (*s_buf_x < max_alpha) cnt_i = 2 * size_mask; else *s_buf_x = max_alpha;
+							*m_buf_x = cnt_o < 0 ? mask::zero :
+								cnt_i < 0 ? mask::full : mask::gray;
+						}
+					}
+					else {
+						// the block is known uniform, either 0 or max_alpha,
+						// where the mask turns from gray into that at once.
+						bool const full = b == mask::full;
+						int& cnt = full ? cnt_i : cnt_o;
+						(full ? cnt_o : cnt_i) = 2 * size_mask;
+						cnt -= xm - x;
+						if (int const n = xb - xm; n > 0) {
+							int const n_gray = std::clamp(cnt, 0, n);
+							std::memset(m_buf_y + (xm - inner_w1), static_cast<int>(mask::gray), n_gray);
+							std::memset(m_buf_y + (xm - inner_w1) + n_gray, static_cast<int>(b), n - n_gray);
+							cnt -= n;
+						}
+					}
 				}
+				s_buf_y += src_w; m_buf_y += inner_w2;
 				if (cnt_o > -src_w) {
 					// some (partially) opaque pixels found.
 					if (bottom < 0) top = bottom = y; else bottom = y;
@@ -23,27 +23,44 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 using namespace Calculation;
 using mask = masking::mask;
 
-template<size_t src_step, size_t a_step>
+// P: the precision of the source plane.
+template<class P, size_t src_step, size_t a_step>
 static inline void find_min(int src_w, int src_h, int size,
-	i16 const* src_buf, size_t src_stride,
+	typename P::type const* src_buf, size_t src_stride,
 	mask const* mask_buf, size_t mask_stride,
-	i16* a_buf, size_t a_stride, i32 const* arc)
+	mask const* blk_buf, size_t blk_stride,
+	i16* a_buf, size_t a_stride, i32 const* arc, row_sink const* sink)
 {
 	// arc[i]: i ranges from -size to size.
 
 	int const dst_w = src_w - 2 * size, dst_h = src_h - 2 * size,
 		disk_area = 1 + 4 * (size + std::accumulate(arc + 1, arc + size + 1, 0));
+	MultiThread::chunks rows{ multi_thread, dst_h };
 	multi_thread(dst_h, [&](int thread_id, int thread_num)
 	{
-		for (int y = thread_id; y < dst_h; y += thread_num) {
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 			auto s_buf_pt = src_buf + size * src_step + (y + size) * src_stride;
 			auto m_buf_pt = mask_buf + y * mask_stride;
 			auto a_buf_pt = a_buf + y * a_stride;
+			auto b_buf_y = blk_buf + (y >> masking::log2_blk_size) * blk_stride;
 
-			int curr_min = max_alpha, curr_min_dur = -1;
+			int curr_min = P::max, curr_min_dur = -1;
 			for (int x = 0; x < dst_w; x++,
 				s_buf_pt += src_step, m_buf_pt++, a_buf_pt += a_step) {
 
+				// skip the whole block if it's uniform.
+				if ((x & (masking::blk_size - 1)) == 0) {
+					if (auto b = b_buf_y[x >> masking::log2_blk_size]; b != mask::gray) {
+						int const n = std::min(masking::blk_size, dst_w - x) - 1;
+						curr_min = b == mask::full ? P::max : 0;
+						curr_min_dur = 2 * size;
+						masking::fill_run(a_buf_pt, a_step, n + 1, P::to_alpha(curr_min));
+
+						x += n; s_buf_pt += n * src_step; m_buf_pt += n; a_buf_pt += n * a_step;
+						continue;
+					}
+				}
+
 				// hints by masking.
 				switch (*m_buf_pt) {
 				case mask::zero:
@@ -51,7 +68,8 @@ static inline void find_min(int src_w, int src_h, int size,
 					curr_min_dur = 2 * size;
 					continue;
 				case mask::full:
-					*a_buf_pt = curr_min = max_alpha;
+					curr_min = P::max;
+					*a_buf_pt = max_alpha;
 					curr_min_dur = 2 * size;
 					continue;
 				}
@@ -79,11 +97,11 @@ static inline void find_min(int src_w, int src_h, int size,
 					}
 
 				search_end1:
-					*a_buf_pt = curr_min;
+					*a_buf_pt = P::to_alpha(curr_min);
 				}
 				else {
 					// search the entire disc.
-					int expiring_min = max_alpha; curr_min = max_alpha;
+					int expiring_min = P::max; curr_min = P::max;
 					for (int dy = -size; dy <= size; dy++) {
 						int const secant = arc[dy];
 						for (int dx = -secant; dx <= secant; dx++) {
@@ -102,18 +120,20 @@ static inline void find_min(int src_w, int src_h, int size,
 					}
 
 				search_end2:
-					*a_buf_pt = std::min(curr_min, expiring_min);
+					*a_buf_pt = P::to_alpha(std::min(curr_min, expiring_min));
 				}
 			}
+			if (sink != nullptr) sink->apply<a_step>(a_buf + y * a_stride, 0, dst_w, y);
 		}
 	});
 }
 
 
+template<class P>
 inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 	int src_w, int src_h,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace masking::deflation;
 
@@ -128,6 +148,7 @@ inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 	auto [src_buf, src_stride, top, bottom] = alloc_and_mask_h(size, mask_buf, mask_stride);
 	if (top >= bottom - 2 * size) return { 0,0,0,0 };
 
+	auto* const blk_buf = mask_buf + mask_stride * src_h;
 	mask_buf += top * mask_stride;
 	src_buf += top * src_stride;
 	dst_buf += top * dst_stride;
@@ -142,9 +163,15 @@ inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 	dst_buf += left * (dst_colored ? 4 : 1);
 	src_w = right - left + 2 * size;
 
-	(dst_colored ? find_min<1, 4> : find_min<1, 1>)
+	size_t const blk_stride = masking::blk_stride(right - left);
+	masking::summarize(right - left, bottom - top, mask_buf, mask_stride, blk_buf, blk_stride);
+	if (keep_hint != nullptr) keep_hint->keep(right - left, bottom - top, blk_buf, blk_stride);
+
+	row_sink const sink_here = sink != nullptr ? sink->move(-left, -top) : row_sink{};
+	(dst_colored ? find_min<P, 1, 4> : find_min<P, 1, 1>)
 		(src_w, src_h, size, src_buf, src_stride,
-			mask_buf, mask_stride, dst_buf, dst_stride, arc + size);
+			mask_buf, mask_stride, blk_buf, blk_stride, dst_buf, dst_stride, arc + size,
+			sink != nullptr ? &sink_here : nullptr);
 
 	return { left, top, right, bottom };
 }
@@ -152,27 +179,32 @@ inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 Bounds max_fast::deflate(int src_w, int src_h,
 	i16* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint const* known)
 {
 	using namespace masking::deflation;
-	return deflate_common([&](int size, mask* mask_buf, size_t mask_stride) {
-		auto [top, bottom] = mask_h_alpha<0>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride);
+	return deflate_common<alpha12>([&](int size, mask* mask_buf, size_t mask_stride) {
+		auto [top, bottom] = mask_h_alpha<0>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, known);
 		return std::tuple{ src_buf, src_stride, top, bottom };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq, nullptr, nullptr);
 }
 
+template<class P>
 Bounds max_fast::deflate(int src_w, int src_h,
 	ExEdit::PixelYCA const* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq, void* alpha_space)
+	void* heap, int size_sq, void* alpha_space, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace masking::deflation;
-	return deflate_common([&](int size, mask* mask_buf, size_t mask_stride) {
-		i16* med_buf = reinterpret_cast<i16*>(alpha_space);
+	return deflate_common<P>([&](int size, mask* mask_buf, size_t mask_stride) {
+		auto* med_buf = reinterpret_cast<typename P::type*>(alpha_space);
 		size_t med_stride = (src_w + 1) & (-2);
-		auto [top, bottom] = mask_h_color<0>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride,
+		auto [top, bottom] = mask_h_color<0, P>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride,
 			med_buf, med_stride);
 		return std::tuple{ med_buf, med_stride, top, bottom };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq, keep_hint, sink);
 }
+template Bounds max_fast::deflate<alpha12>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, void*, int, void*, masking::hint*, row_sink const*);
+template Bounds max_fast::deflate<alpha8>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, void*, int, void*, masking::hint*, row_sink const*);
 
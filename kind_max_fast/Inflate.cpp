@@ -22,127 +22,175 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 using namespace Calculation;
 using mask = masking::mask;
 
-template<size_t src_step, size_t a_step>
+// number of adjacent columns processed together by a thread,
+// so that every row access within a block is contiguous.
+constexpr int col_block = 16;
+static_assert(col_block == masking::blk_size);
+
+// P: the precision of the source plane.
+template<class P, size_t src_step, size_t a_step>
 static inline void find_max(int src_w, int src_h, int size,
-	i16 const* src_buf, size_t src_stride,
+	typename P::type const* src_buf, size_t src_stride,
 	mask const* mask_buf, size_t mask_stride,
-	i16* a_buf, size_t a_stride, i32 const* arc)
+	mask const* blk_buf, size_t blk_stride,
+	i16* a_buf, size_t a_stride, i32 const* arc, row_sink const* sink)
 {
 	// arc[i]: i ranges from -size to size.
 
 	int dst_w = src_w + 2 * size, dst_h = src_h + 2 * size;
-	multi_thread(dst_w, [&](int thread_id, int thread_num)
-	{
-		for (int x = thread_id; x < dst_w; x += thread_num) {
-			auto s_buf_pt = src_buf + (x - size) * src_step - size * src_stride;
-			auto m_buf_pt = mask_buf + x;
-			auto a_buf_pt = a_buf + x * a_step;
 
-			int curr_max = 0, curr_max_dur = -1;
-			int const dx_min = std::max(-size, size - x), dx_max = std::min(size, dst_w - size - 1 - x);
+	// process a block of adjacent columns if there are enough columns for every thread,
+	// otherwise a single column at a time so each thread still gets its share.
+	// results are identical either way, as each column is processed independently.
+	int const block = dst_w >= col_block * multi_thread.num_threads() ? col_block : 1,
+		num_blocks = (dst_w + block - 1) / block;
+	multi_thread(num_blocks, [&](int thread_id, int thread_num)
+	{
+		struct state {
+			int curr_max, curr_max_dur;
+			bool done; // the rest of the column is known to be transparent.
+		} states[col_block];
+
+		for (int b_idx = thread_id; b_idx < num_blocks; b_idx += thread_num) {
+			int const x0 = b_idx * block, x1 = std::min(x0 + block, dst_w);
+			for (auto& st : states) st = { .curr_max = 0, .curr_max_dur = -1, .done = false };
+
+			auto s_buf_y = src_buf + (x0 - size) * src_step - size * src_stride;
+			auto m_buf_y = mask_buf + x0;
+			auto a_buf_y = a_buf + x0 * a_step;
 			for (int y = 0; y < dst_h; y++,
-				s_buf_pt += src_stride, m_buf_pt += mask_stride, a_buf_pt += a_stride) {
-
-				// hints by masking.
-				switch (*m_buf_pt) {
-				case mask::zero:
-					*a_buf_pt = curr_max = 0;
-					curr_max_dur = 2 * size;
-					if (y >= dst_h - size) {
-						for (int rest = dst_h - y; --rest >= 0; a_buf_pt += a_stride) *a_buf_pt = 0;
-						y = dst_h; // to break the for-loop, not the switch-block.
+				s_buf_y += src_stride, m_buf_y += mask_stride, a_buf_y += a_stride) {
+				auto s_buf_pt = s_buf_y; auto m_buf_pt = m_buf_y; auto a_buf_pt = a_buf_y;
+				auto st = states;
+
+				// the block of columns coincides with a block of the summary.
+				// if it's uniform, no search is needed for this row.
+				if (auto b = block == col_block ?
+					blk_buf[(y >> masking::log2_blk_size) * blk_stride + b_idx] : mask::gray;
+					b != mask::gray) {
+					bool const last = y >= dst_h - size;
+					for (int x = x0; x < x1; x++, st++, a_buf_pt += a_step) {
+						auto& [curr_max, curr_max_dur, done] = *st;
+						if (done) *a_buf_pt = 0;
+						else {
+							curr_max = b == mask::full ? P::max : 0;
+							*a_buf_pt = P::to_alpha(curr_max);
+							curr_max_dur = 2 * size;
+							if (b == mask::zero && last) done = true;
+						}
 					}
-					continue;
-				case mask::full:
-					*a_buf_pt = curr_max = max_alpha;
-					curr_max_dur = 2 * size;
-					continue;
 				}
-
-				if (--curr_max_dur >= 0) {
-					// search the points on the "incoming arc".
-					if (y >= dst_h - size) {
-						if (curr_max > 0) {
-							*a_buf_pt = curr_max;
-							continue;
-						}
-						for (int rest = dst_h - y; --rest >= 0; a_buf_pt += a_stride) *a_buf_pt = 0;
-						break;
+				else for (int x = x0; x < x1; x++, st++,
+					s_buf_pt += src_step, m_buf_pt++, a_buf_pt += a_step) {
+					auto& [curr_max, curr_max_dur, done] = *st;
+					if (done) {
+						*a_buf_pt = 0;
+						continue;
 					}
 
-					int dx0 = dx_min, dx1 = dx_max, c0 = 0, c1 = 1;
-					if (y < size) {
-						auto c = arc[size - y];
-						dx0 = std::max(-c, dx0);
-						dx1 = std::min(+c, dx1);
+					// hints by masking.
+					switch (*m_buf_pt) {
+					case mask::zero:
+						*a_buf_pt = curr_max = 0;
+						curr_max_dur = 2 * size;
+						if (y >= dst_h - size) done = true;
+						continue;
+					case mask::full:
+						curr_max = P::max;
+						*a_buf_pt = max_alpha;
+						curr_max_dur = 2 * size;
+						continue;
 					}
-					if (y >= dst_h - 2 * size) {
-						c1 = arc[dst_h - size - y] + 1; c0 = -c1;
-					}
-					c0 = std::min(c0, dx1); c1 = std::max(c1, dx0);
-
-					auto examine = [&](int dx) {
-						int dy = arc[dx];
-						int a = s_buf_pt[dx * src_step + dy * src_stride];
-						if (a >= curr_max) {
-							int dur = 2 * dy;
-							if (a > curr_max || dur > curr_max_dur) {
-								curr_max = a; curr_max_dur = dur;
-								if (a >= max_alpha) return true;
+
+					int const dx_min = std::max(-size, size - x), dx_max = std::min(size, dst_w - size - 1 - x);
+					if (--curr_max_dur >= 0) {
+						// search the points on the "incoming arc".
+						if (y >= dst_h - size) {
+							if (curr_max > 0) {
+								*a_buf_pt = P::to_alpha(curr_max);
+								continue;
 							}
+							*a_buf_pt = 0;
+							done = true;
+							continue;
 						}
-						return false;
-					};
 
-					for (int dx = c0; dx >= dx0; dx--) {
-						if (examine(dx)) goto search_end1;
-					}
-					for (int dx = c1; dx <= dx1; dx++) {
-						if (examine(dx)) goto search_end1;
-					}
+						int dx0 = dx_min, dx1 = dx_max, c0 = 0, c1 = 1;
+						if (y < size) {
+							auto c = arc[size - y];
+							dx0 = std::max(-c, dx0);
+							dx1 = std::min(+c, dx1);
+						}
+						if (y >= dst_h - 2 * size) {
+							c1 = arc[dst_h - size - y] + 1; c0 = -c1;
+						}
+						c0 = std::min(c0, dx1); c1 = std::max(c1, dx0);
 
-				search_end1:
-					*a_buf_pt = curr_max;
-				}
-				else {
-					// search the entire disc.
-					int expiring_max = 0; curr_max = 0;
-					int const
-						dy0 = std::max(-size, size - y),
-						dy1 = std::min(+size, dst_h - size - 1 - y);
-					for (int dy = dy0; dy <= dy1; dy++) {
-						int const secant = arc[dy],
-							dx0 = std::max(-secant, dx_min),
-							dx1 = std::min(+secant, dx_max);
-						auto s_buf_dy = s_buf_pt + dx0 * src_step + dy * src_stride;
-						for (int dx = dx0; dx <= dx1; dx++, s_buf_dy += src_step) {
-							int a = *s_buf_dy;
+						auto examine = [&](int dx) {
+							int dy = arc[dx];
+							int a = s_buf_pt[dx * src_step + dy * src_stride];
 							if (a >= curr_max) {
-								int dur = arc[dx] + dy;
+								int dur = 2 * dy;
 								if (a > curr_max || dur > curr_max_dur) {
-									if (dur > 0) {
-										curr_max = a; curr_max_dur = dur;
-										if (a >= max_alpha) goto search_end2;
-									}
-									else if (a > expiring_max) expiring_max = a;
+									curr_max = a; curr_max_dur = dur;
+									if (a >= P::max) return true;
 								}
 							}
+							return false;
+						};
+
+						for (int dx = c0; dx >= dx0; dx--) {
+							if (examine(dx)) goto search_end1;
 						}
+						for (int dx = c1; dx <= dx1; dx++) {
+							if (examine(dx)) goto search_end1;
+						}
+
+					search_end1:
+						*a_buf_pt = P::to_alpha(curr_max);
 					}
+					else {
+						// search the entire disc.
+						int expiring_max = 0; curr_max = 0;
+						int const
+							dy0 = std::max(-size, size - y),
+							dy1 = std::min(+size, dst_h - size - 1 - y);
+						for (int dy = dy0; dy <= dy1; dy++) {
+							int const secant = arc[dy],
+								dx0 = std::max(-secant, dx_min),
+								dx1 = std::min(+secant, dx_max);
+							auto s_buf_dy = s_buf_pt + dx0 * src_step + dy * src_stride;
+							for (int dx = dx0; dx <= dx1; dx++, s_buf_dy += src_step) {
+								int a = *s_buf_dy;
+								if (a >= curr_max) {
+									int dur = arc[dx] + dy;
+									if (a > curr_max || dur > curr_max_dur) {
+										if (dur > 0) {
+											curr_max = a; curr_max_dur = dur;
+											if (a >= P::max) goto search_end2;
+										}
+										else if (a > expiring_max) expiring_max = a;
+									}
+								}
+							}
+						}
 
-				search_end2:
-					*a_buf_pt = std::max(curr_max, expiring_max);
+					search_end2:
+						*a_buf_pt = P::to_alpha(std::max(curr_max, expiring_max));
+					}
 				}
+				if (sink != nullptr) sink->apply<a_step>(a_buf + y * a_stride, x0, x1, y);
 			}
 		}
 	});
 }
 
 
+template<class P>
 inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 	int src_w, int src_h,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace masking::inflation;
 
@@ -162,6 +210,8 @@ inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 	dst_buf += left * (dst_colored ? 4 : 1);
 	src_w = right - left;
 
+	auto* const blk_buf = mask_buf - left + mask_stride * (src_h + 2 * size);
+
 	auto [top, bottom] = mask_h(src_w, src_h, size, mask_buf, mask_stride);
 
 	right += 2 * size;
@@ -170,9 +220,15 @@ inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 	dst_buf += top * dst_stride;
 	src_h = bottom - top - 2 * size;
 
-	(dst_colored ? find_max<1, 4> : find_max<1, 1>)
+	size_t const blk_stride = masking::blk_stride(src_w + 2 * size);
+	masking::summarize(src_w + 2 * size, src_h + 2 * size, mask_buf, mask_stride, blk_buf, blk_stride);
+	if (keep_hint != nullptr) keep_hint->keep(src_w + 2 * size, src_h + 2 * size, blk_buf, blk_stride);
+
+	row_sink const sink_here = sink != nullptr ? sink->move(-left, -top) : row_sink{};
+	(dst_colored ? find_max<P, 1, 4> : find_max<P, 1, 1>)
 		(src_w, src_h, size, src_buf, src_stride,
-			mask_buf, mask_stride, dst_buf, dst_stride, arc + size);
+			mask_buf, mask_stride, blk_buf, blk_stride, dst_buf, dst_stride, arc + size,
+			sink != nullptr ? &sink_here : nullptr);
 
 	return { left, top, right, bottom };
 }
@@ -180,28 +236,33 @@ inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 Bounds max_fast::inflate(int src_w, int src_h,
 	i16* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint const* known, row_sink const* sink)
 {
 	using namespace masking::inflation;
-	return inflate_common([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
-		auto [left, right] = mask_v_alpha(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap);
+	return inflate_common<alpha12>([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
+		auto [left, right] = mask_v_alpha(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap, known);
 		return std::tuple{ src_buf, src_stride, left, right };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq, nullptr, sink);
 }
 
+template<class P>
 Bounds max_fast::inflate(int src_w, int src_h,
 	ExEdit::PixelYCA const* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride,
-	void* heap, int size_sq, void* alpha_space)
+	void* heap, int size_sq, void* alpha_space, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace masking::inflation;
-	return inflate_common([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
-		i16* med_buf = reinterpret_cast<i16*>(alpha_space);
+	return inflate_common<P>([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
+		auto* med_buf = reinterpret_cast<typename P::type*>(alpha_space);
 		size_t med_stride = (src_w + 1) & (-2);
-		auto [left, right] = mask_v_color(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap,
+		auto [left, right] = mask_v_color<P>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap,
 			med_buf, med_stride);
 
 		return std::tuple{ med_buf, med_stride, left, right };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, heap, size_sq, keep_hint, sink);
 }
+template Bounds max_fast::inflate<alpha12>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, void*, int, void*, masking::hint*, row_sink const*);
+template Bounds max_fast::inflate<alpha8>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, void*, int, void*, masking::hint*, row_sink const*);
 
@@ -15,41 +15,50 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 #include <cstdint>
 #include <exedit/pixel.hpp>
 #include "../buffer_base.hpp"
+#include "../kind_max/masking.hpp"
 
 namespace Calculation::max_fast
 {
+	// if `sink` is given, it's applied to each row of the result right after it's written.
 	Bounds inflate(int src_w, int src_h,
 		i16* src_buf, size_t src_stride,
 		i16* dst_buf, bool dst_colored, size_t dst_stride,
-		void* heap, int size_sq);
+		void* heap, int size_sq, masking::hint const* known = nullptr, row_sink const* sink = nullptr);
+	// the alpha of the source is kept in the precision `P` during the process.
+	template<class P = alpha12>
 	Bounds inflate(int src_w, int src_h,
 		ExEdit::PixelYCA const* src_buf, size_t src_stride,
 		i16* dst_buf, bool dst_colored, size_t dst_stride,
-		void* heap, int size_sq, void* alpha_space);
+		void* heap, int size_sq, void* alpha_space, masking::hint* keep_hint = nullptr, row_sink const* sink = nullptr);
 
 	template<int denom>
 	constexpr int inflate_radius(int numer) { return numer / denom; }
 	// size = floor(size_sq^(1/2)).
 	constexpr size_t inflate_heap_size(int dst_w, int dst_h, int size) {
 		return sizeof(int8_t) * (dst_w * dst_h) + sizeof(i32) * (2 * size + 1)
-			+ 2 * sizeof(i32) * dst_w;
+			+ 2 * sizeof(i32) * dst_w
+			+ masking::summary_size(dst_w, dst_h);
 	}
 
 	Bounds deflate(int src_w, int src_h,
 		i16* src_buf, size_t src_stride,
 		i16* dst_buf, bool dst_colored, size_t dst_stride,
-		void* heap, int size_sq);
+		void* heap, int size_sq, masking::hint const* known = nullptr);
+	// if `sink` is given, it's applied to each row of the result right after it's written.
+	// the alpha of the source is kept in the precision `P` during the process.
+	template<class P = alpha12>
 	Bounds deflate(int src_w, int src_h,
 		ExEdit::PixelYCA const* src_buf, size_t src_stride,
 		i16* dst_buf, bool dst_colored, size_t dst_stride,
-		void* heap, int size_sq, void* alpha_space);
+		void* heap, int size_sq, void* alpha_space, masking::hint* keep_hint = nullptr, row_sink const* sink = nullptr);
 
 	template<int denom>
 	constexpr int deflate_radius(int numer) { return numer / denom; }
 	// size = floor(size_sq^(1/2)).
 	constexpr size_t deflate_heap_size(int src_w, int src_h, int size) {
 		return sizeof(int8_t) * (src_w * src_h) + sizeof(i32) * (2 * size + 1)
-			+ 2 * sizeof(i32) * (src_w - 2 * size);
+			+ 2 * sizeof(i32) * (src_w - 2 * size)
+			+ masking::summary_size(src_w - 2 * size, src_h - 2 * size);
 	}
 
 	constexpr size_t alpha_space_size(int src_w, int src_h) {
@@ -11,6 +11,7 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 */
 
 #include <cstdint>
+#include <cstring>
 #include <algorithm>
 #include <tuple>
 #include <numeric>
@@ -25,18 +26,22 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 using namespace Calculation;
 using mask = masking::mask;
 
-template<size_t src_step, size_t a_step>
+// P: the precision of the source plane.
+// R: size_disk fixed at compile time, or 0 if it's not.
+template<class P, int R, size_t src_step, size_t a_step>
 static inline void take_inv_sum(int src_w, int src_h, int size_canvas, int size_disk,
-	i16 const* src_buf, size_t src_stride,
+	typename P::type const* src_buf, size_t src_stride,
 	mask const* mask_buf, size_t mask_stride,
-	i16* a_buf, size_t a_stride, int a_sum_cap, i32 const* arc)
+	mask const* blk_buf, size_t blk_stride,
+	i16* a_buf, size_t a_stride, int a_sum_cap, i32 const* arc, row_sink const* sink)
 {
 	// assumably, size_canvas = max(0, size_disk-1).
 	// arc[i]: i ranges from -size_disk to size_disk.
 
-	int64_t const max_sum_alpha = static_cast<int64_t>(max_alpha)
+	int64_t const max_sum_alpha = static_cast<int64_t>(P::max)
 		* (1 + 4 * (size_disk + std::accumulate(arc + 1, arc + size_disk + 1, 0))),
-		sum_full_val = max_sum_alpha - (1 + 2 * size_disk) * max_alpha;
+		sum_full_val = max_sum_alpha - (1 + 2 * size_disk) * P::max;
+	a_sum_cap = static_cast<int>((static_cast<int64_t>(a_sum_cap) * P::max) >> log2_max_alpha);
 
 	int const denom_bits = [](int N) {
 		if (N <= 15) return 0;
@@ -50,6 +55,24 @@ static inline void take_inv_sum(int src_w, int src_h, int size_canvas, int size_
 			inv) >> denom_bits) * numer + ((1 << 19) - 1)) >> 19);
 	};
 
+	// offsets to the points on the arcs, for the unrolled loops.
+	// _h for horizontal steps, _v for vertical steps, _l for leaving points and _e for entering points.
+	ptrdiff_t ofs_l2r_l[2 * R + 1], ofs_l2r_e[2 * R + 1],
+		ofs_r2l_l[2 * R + 1], ofs_r2l_e[2 * R + 1],
+		ofs_v_l[2 * R + 1], ofs_v_e[2 * R + 1];
+	if constexpr (R > 0) {
+		constexpr auto step = static_cast<ptrdiff_t>(src_step);
+		auto const stride = static_cast<ptrdiff_t>(src_stride);
+		for (int d = -R; d <= R; d++) {
+			ofs_l2r_l[R + d] = d * stride - (arc[d] + 1) * step;
+			ofs_l2r_e[R + d] = d * stride + arc[d] * step;
+			ofs_r2l_l[R + d] = d * stride + (arc[d] + 1) * step;
+			ofs_r2l_e[R + d] = d * stride - arc[d] * step;
+			ofs_v_l[R + d] = d * step - (arc[d] + 1) * stride;
+			ofs_v_e[R + d] = d * step + arc[d] * stride;
+		}
+	}
+
 	int const dst_w = src_w - 2 * size_canvas, dst_h = src_h - 2 * size_canvas;
 	multi_thread(dst_h, [&](int thread_id, int thread_num)
 	{
@@ -85,29 +108,59 @@ static inline void take_inv_sum(int src_w, int src_h, int size_canvas, int size_
 				case mask::full: sum_alpha = max_sum_alpha; break;
 				case mask::gray:
 				default:
-					auto s_buf_dx = s_buf_pt - size_disk * src_step;
 					int_fast32_t diff = 0;
-					for (int dx = -size_disk; dx <= size_disk; dx++, s_buf_dx += src_step)
-						diff += -s_buf_dx[-(arc[dx] + 1) * src_stride] + s_buf_dx[+arc[dx] * src_stride];
+					if constexpr (R > 0)
+						arith::arc::unroll<R>([&](int dx) { diff += -s_buf_pt[ofs_v_l[R + dx]] + s_buf_pt[ofs_v_e[R + dx]]; });
+					else {
+						auto s_buf_dx = s_buf_pt - size_disk * src_step;
+						for (int dx = -size_disk; dx <= size_disk; dx++, s_buf_dx += src_step)
+							diff += -s_buf_dx[-(arc[dx] + 1) * src_stride] + s_buf_dx[+arc[dx] * src_stride];
+					}
 					sum_alpha += diff;
 					break;
 				}
 			}
 
+			// uniform blocks are skipped as a whole,
+			// except for the one containing the first pixel of the sweep.
+			auto const b_buf_y = blk_buf + (y >> masking::log2_blk_size) * blk_stride;
+			auto skip_block = [&](int x, int n) {
+				auto b = b_buf_y[x >> masking::log2_blk_size];
+				if (b == mask::gray) return false;
+
+				bool const full = b == mask::full;
+				masking::fill_run(a_buf + y * a_stride + x * a_step, a_step, n,
+					full ? max_alpha : 0);
+				sum_alpha = full ? max_sum_alpha : 0;
+				return true;
+			};
+
 			if (l2r) {
 				for (int x = 0; x < dst_w; x++,
 					s_buf_pt += src_step, m_buf_pt++, a_buf_pt += a_step) {
 					if (x > 0) {
+						if ((x & (masking::blk_size - 1)) == 0) {
+							int const n = std::min(masking::blk_size, dst_w - x) - 1;
+							if (skip_block(x, n + 1)) {
+								x += n; s_buf_pt += n * src_step; m_buf_pt += n; a_buf_pt += n * a_step;
+								continue;
+							}
+						}
+
 						switch (*m_buf_pt) {
 						case mask::zero: *a_buf_pt = 0; sum_alpha = 0; continue;
 						case mask::full: *a_buf_pt = max_alpha; sum_alpha = max_sum_alpha; continue;
 						}
 
 						// aggregate the points on the "incoming" and "outgoing" arcs.
-						auto s_buf_dy = s_buf_pt - size_disk * src_stride;
 						int_fast32_t diff = 0;
-						for (int dy = -size_disk; dy <= size_disk; dy++, s_buf_dy += src_stride)
-							diff += -s_buf_dy[-(arc[dy] + 1) * src_step] + s_buf_dy[+arc[dy] * src_step];
+						if constexpr (R > 0)
+							arith::arc::unroll<R>([&](int dy) { diff += -s_buf_pt[ofs_l2r_l[R + dy]] + s_buf_pt[ofs_l2r_e[R + dy]]; });
+						else {
+							auto s_buf_dy = s_buf_pt - size_disk * src_stride;
+							for (int dy = -size_disk; dy <= size_disk; dy++, s_buf_dy += src_stride)
+								diff += -s_buf_dy[-(arc[dy] + 1) * src_step] + s_buf_dy[+arc[dy] * src_step];
+						}
 						sum_alpha += diff;
 					}
 
@@ -120,16 +173,28 @@ static inline void take_inv_sum(int src_w, int src_h, int size_canvas, int size_
 				for (int x = dst_w - 1; x >= 0; x--,
 					s_buf_pt -= src_step, m_buf_pt--, a_buf_pt -= a_step) {
 					if (x < dst_w - 1) {
+						if ((x & (masking::blk_size - 1)) == masking::blk_size - 1) {
+							int const n = x & (masking::blk_size - 1);
+							if (skip_block(x - n, n + 1)) {
+								x -= n; s_buf_pt -= n * src_step; m_buf_pt -= n; a_buf_pt -= n * a_step;
+								continue;
+							}
+						}
+
 						switch (*m_buf_pt) {
 						case mask::zero: *a_buf_pt = 0; sum_alpha = 0; continue;
 						case mask::full: *a_buf_pt = max_alpha; sum_alpha = max_sum_alpha; continue;
 						}
 
 						// aggregate the points on the "incoming" and "outgoing" arcs.
-						auto s_buf_dy = s_buf_pt - size_disk * src_stride;
 						int_fast32_t diff = 0;
-						for (int dy = -size_disk; dy <= size_disk; dy++, s_buf_dy += src_stride)
-							diff += s_buf_dy[-arc[dy] * src_step] - s_buf_dy[+(arc[dy] + 1) * src_step];
+						if constexpr (R > 0)
+							arith::arc::unroll<R>([&](int dy) { diff += s_buf_pt[ofs_r2l_e[R + dy]] - s_buf_pt[ofs_r2l_l[R + dy]]; });
+						else {
+							auto s_buf_dy = s_buf_pt - size_disk * src_stride;
+							for (int dy = -size_disk; dy <= size_disk; dy++, s_buf_dy += src_stride)
+								diff += s_buf_dy[-arc[dy] * src_step] - s_buf_dy[+(arc[dy] + 1) * src_step];
+						}
 						sum_alpha += diff;
 					}
 
@@ -138,15 +203,17 @@ static inline void take_inv_sum(int src_w, int src_h, int size_canvas, int size_
 				}
 				s_buf_pt += src_step; m_buf_pt++; a_buf_pt += a_step;
 			}
+			if (sink != nullptr) sink->apply<a_step>(a_buf + y * a_stride, 0, dst_w, y);
 		}
 	});
 }
 
 
+template<class P>
 inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 	int src_w, int src_h,
 	i16* dst_buf, bool dst_colored, size_t dst_stride, int a_sum_cap_rate,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace sum;
 	using namespace masking::deflation;
@@ -163,6 +230,7 @@ inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 	auto [src_buf, src_stride, top, bottom] = alloc_and_mask_h(size, size_disk, mask_buf, mask_stride);
 	if (top >= bottom - 2 * size) return { 0,0,0,0 };
 
+	auto* const blk_buf = mask_buf + mask_stride * src_h;
 	mask_buf += top * mask_stride;
 	src_buf += top * src_stride;
 	dst_buf += top * dst_stride;
@@ -191,10 +259,18 @@ inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 			std::memset(src_buf + (left - diff) + src_h * src_stride, 0, sizeof(*src_buf) * len);
 	}
 
-	(dst_colored ? take_inv_sum<1, 4> : take_inv_sum<1, 1>)
-		(src_w, src_h, size, size_disk, src_buf, src_stride,
-			mask_buf, mask_stride, dst_buf, dst_stride,
-			a_sum_cap_from_rate(a_sum_cap_rate, size_sq), arc + size_disk);
+	size_t const blk_stride = masking::blk_stride(right - left);
+	masking::summarize(right - left, bottom - top, mask_buf, mask_stride, blk_buf, blk_stride);
+	if (keep_hint != nullptr) keep_hint->keep(right - left, bottom - top, blk_buf, blk_stride);
+
+	row_sink const sink_here = sink != nullptr ? sink->move(-left, -top) : row_sink{};
+	arith::arc::dispatch(size_disk, [&]<int R>(std::integral_constant<int, R>) {
+		(dst_colored ? take_inv_sum<P, R, 1, 4> : take_inv_sum<P, R, 1, 1>)
+			(src_w, src_h, size, size_disk, src_buf, src_stride,
+				mask_buf, mask_stride, blk_buf, blk_stride, dst_buf, dst_stride,
+				a_sum_cap_from_rate(a_sum_cap_rate, size_sq), arc + size_disk,
+				sink != nullptr ? &sink_here : nullptr);
+	});
 
 	return { left, top, right, bottom };
 }
@@ -202,29 +278,34 @@ inline static Bounds deflate_common(auto&& alloc_and_mask_h,
 Bounds sum::deflate(int src_w, int src_h,
 	i16* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride, int a_sum_cap_rate,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint const* known)
 {
 	using namespace masking::deflation;
-	return deflate_common([&](int size, int size_disk, mask* mask_buf, size_t mask_stride) {
+	return deflate_common<alpha12>([&](int size, int size_disk, mask* mask_buf, size_t mask_stride) {
 		auto [top, bottom] = (size < size_disk ? mask_h_alpha<1> : mask_h_alpha<0>)
-			(src_w, src_h, size_disk, src_buf, src_stride, mask_buf, mask_stride);
+			(src_w, src_h, size_disk, src_buf, src_stride, mask_buf, mask_stride, known);
 		return std::tuple{ src_buf, src_stride, top, bottom };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, a_sum_cap_rate, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, a_sum_cap_rate, heap, size_sq, nullptr, nullptr);
 }
 
+template<class P>
 Bounds sum::deflate(int src_w, int src_h,
 	ExEdit::PixelYCA const* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride, int a_sum_cap_rate,
-	void* heap, int size_sq, void* alpha_space)
+	void* heap, int size_sq, void* alpha_space, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace masking::deflation;
-	return deflate_common([&](int size, int size_disk, mask* mask_buf, size_t mask_stride) {
+	return deflate_common<P>([&](int size, int size_disk, mask* mask_buf, size_t mask_stride) {
 		size_t med_stride = (src_w + 3) & (-2);
-		i16* med_buf = reinterpret_cast<i16*>(alpha_space) + (1 + med_stride);
+		auto* med_buf = reinterpret_cast<typename P::type*>(alpha_space) + (1 + med_stride);
 
-		auto [top, bottom] = (size < size_disk ? mask_h_color<1> : mask_h_color<0>)
+		auto [top, bottom] = (size < size_disk ? mask_h_color<1, P> : mask_h_color<0, P>)
 			(src_w, src_h, size_disk, src_buf, src_stride, mask_buf, mask_stride, med_buf, med_stride);
 		return std::tuple{ med_buf, med_stride, top, bottom };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, a_sum_cap_rate, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, a_sum_cap_rate, heap, size_sq, keep_hint, sink);
 }
+template Bounds sum::deflate<alpha12>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, int, void*, int, void*, masking::hint*, row_sink const*);
+template Bounds sum::deflate<alpha8>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, int, void*, int, void*, masking::hint*, row_sink const*);
 
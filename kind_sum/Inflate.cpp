@@ -24,17 +24,21 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 using namespace Calculation;
 using mask = masking::mask;
 
-template<size_t src_step, size_t a_step>
+// P: the precision of the source plane.
+// R: the size fixed at compile time, or 0 if it's not.
+template<class P, int R, size_t src_step, size_t a_step>
 static inline void take_sum(int src_w, int src_h, int size,
-	i16 const* src_buf, size_t src_stride,
+	typename P::type const* src_buf, size_t src_stride,
 	mask const* mask_buf, size_t mask_stride,
-	i16* a_buf, size_t a_stride, int a_sum_cap, i32 const* arc)
+	mask const* blk_buf, size_t blk_stride,
+	i16* a_buf, size_t a_stride, int a_sum_cap, i32 const* arc, row_sink const* sink)
 {
 	// arc[i]: i ranges from -size to size.
 
-	int64_t const max_sum_alpha = static_cast<int64_t>(max_alpha)
+	int64_t const max_sum_alpha = static_cast<int64_t>(P::max)
 		* (1 + 4 * (size + std::accumulate(arc + 1, arc + size + 1, 0))),
-		sum_full_val = max_sum_alpha - (1 + 2 * size) * max_alpha;
+		sum_full_val = max_sum_alpha - (1 + 2 * size) * P::max;
+	a_sum_cap = static_cast<int>((static_cast<int64_t>(a_sum_cap) * P::max) >> log2_max_alpha);
 
 	int const denom_bits = [](int N) {
 		if (N <= 15) return 0;
@@ -47,19 +51,43 @@ static inline void take_sum(int src_w, int src_h, int size,
 			sum >> denom_bits) * numer + ((1 << 19) - 1)) >> 19);
 	};
 
+	// offsets to the points on the whole arcs, for the unrolled loops.
+	ptrdiff_t ofs_in[2 * R + 1], ofs_out[2 * R + 1];
+	if constexpr (R > 0) {
+		for (int dy = -R; dy <= R; dy++) {
+			ofs_in[R + dy] = +arc[dy] * static_cast<ptrdiff_t>(src_step) + dy * static_cast<ptrdiff_t>(src_stride);
+			ofs_out[R + dy] = -arc[dy] * static_cast<ptrdiff_t>(src_step) + dy * static_cast<ptrdiff_t>(src_stride);
+		}
+	}
+
 	int const dst_w = src_w + 2 * size, dst_h = src_h + 2 * size;
+	MultiThread::chunks rows{ multi_thread, dst_h };
 	multi_thread(dst_h, [&](int thread_id, int thread_num)
 	{
-		for (int y = thread_id; y < dst_h; y += thread_num) {
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
 			auto s_buf_pt = src_buf - size * src_step + (y - size) * src_stride;
 			auto m_buf_pt = mask_buf + y * mask_stride;
 			auto a_buf_pt = a_buf + y * a_stride;
+			auto b_buf_y = blk_buf + (y >> masking::log2_blk_size) * blk_stride;
 
 			int64_t sum_alpha = 0;
 			int const dy_min = std::max(-size, size - y), dy_max = std::min(size, dst_h - size - 1 - y);
 			for (int x = 0; x < dst_w; x++,
 				s_buf_pt += src_step, m_buf_pt++, a_buf_pt += a_step) {
 
+				// skip the whole block if it's uniform.
+				if ((x & (masking::blk_size - 1)) == 0) {
+					if (auto b = b_buf_y[x >> masking::log2_blk_size]; b != mask::gray) {
+						int const n = std::min(masking::blk_size, dst_w - x) - 1;
+						bool const full = b == mask::full;
+						masking::fill_run(a_buf_pt, a_step, n + 1, full ? max_alpha : 0);
+						sum_alpha = full ? sum_full_val : 0;
+
+						x += n; s_buf_pt += n * src_step; m_buf_pt += n; a_buf_pt += n * a_step;
+						continue;
+					}
+				}
+
 				// hints by masking.
 				switch (*m_buf_pt) {
 				case mask::zero: *a_buf_pt = 0; sum_alpha = 0; continue;
@@ -75,7 +103,9 @@ static inline void take_sum(int src_w, int src_h, int size,
 						dy1 = std::min(+c, dy_max);
 					}
 					int_fast32_t diff = 0;
-					if (x < dst_w - 2 * size) {
+					if (R > 0 && dy0 == -R && dy1 == R && x < dst_w - 2 * R)
+						arith::arc::unroll<R>([&](int dy) { diff += s_buf_pt[ofs_in[R + dy]]; });
+					else if (x < dst_w - 2 * size) {
 						for (int dy = dy0; dy <= dy1; dy++)
 							diff += s_buf_pt[+arc[dy] * src_step + dy * src_stride];
 					}
@@ -102,7 +132,9 @@ static inline void take_sum(int src_w, int src_h, int size,
 						dy1 = std::min(+c, dy_max);
 					}
 					int_fast32_t diff = 0;
-					if (x >= 2 * size) {
+					if (R > 0 && dy0 == -R && dy1 == R && x >= 2 * R)
+						arith::arc::unroll<R>([&](int dy) { diff += s_buf_pt[ofs_out[R + dy]]; });
+					else if (x >= 2 * size) {
 						for (int dy = dy0; dy <= dy1; dy++)
 							diff += s_buf_pt[-arc[dy] * src_step + dy * src_stride];
 					}
@@ -117,15 +149,17 @@ static inline void take_sum(int src_w, int src_h, int size,
 					sum_alpha -= diff;
 				}
 			}
+			if (sink != nullptr) sink->apply<a_step>(a_buf + y * a_stride, 0, dst_w, y);
 		}
 	});
 }
 
 
+template<class P>
 inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 	int src_w, int src_h,
 	i16* dst_buf, bool dst_colored, size_t dst_stride, int a_sum_cap_rate,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace sum;
 	using namespace masking::inflation;
@@ -146,6 +180,8 @@ inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 	dst_buf += left * (dst_colored ? 4 : 1);
 	src_w = right - left;
 
+	auto* const blk_buf = mask_buf - left + mask_stride * (src_h + 2 * size);
+
 	auto [top, bottom] = mask_h(src_w, src_h, size, mask_buf, mask_stride);
 
 	right += 2 * size;
@@ -154,10 +190,18 @@ inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 	dst_buf += top * dst_stride;
 	src_h = bottom - top - 2 * size;
 
-	(dst_colored ? take_sum<1, 4> : take_sum<1, 1>)
-		(src_w, src_h, size, src_buf, src_stride,
-			mask_buf, mask_stride, dst_buf, dst_stride,
-			a_sum_cap_from_rate(a_sum_cap_rate, size_sq), arc + size);
+	size_t const blk_stride = masking::blk_stride(src_w + 2 * size);
+	masking::summarize(src_w + 2 * size, src_h + 2 * size, mask_buf, mask_stride, blk_buf, blk_stride);
+	if (keep_hint != nullptr) keep_hint->keep(src_w + 2 * size, src_h + 2 * size, blk_buf, blk_stride);
+
+	row_sink const sink_here = sink != nullptr ? sink->move(-left, -top) : row_sink{};
+	arith::arc::dispatch(size, [&]<int R>(std::integral_constant<int, R>) {
+		(dst_colored ? take_sum<P, R, 1, 4> : take_sum<P, R, 1, 1>)
+			(src_w, src_h, size, src_buf, src_stride,
+				mask_buf, mask_stride, blk_buf, blk_stride, dst_buf, dst_stride,
+				a_sum_cap_from_rate(a_sum_cap_rate, size_sq), arc + size,
+				sink != nullptr ? &sink_here : nullptr);
+	});
 
 	return { left, top, right, bottom };
 }
@@ -165,28 +209,33 @@ inline static Bounds inflate_common(auto&& alloc_and_mask_v,
 Bounds sum::inflate(int src_w, int src_h,
 	i16* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride, int a_sum_cap_rate,
-	void* heap, int size_sq)
+	void* heap, int size_sq, masking::hint const* known, row_sink const* sink)
 {
 	using namespace masking::inflation;
-	return inflate_common([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
-		auto [left, right] = mask_v_alpha(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap);
+	return inflate_common<alpha12>([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
+		auto [left, right] = mask_v_alpha(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap, known);
 		return std::tuple{ src_buf, src_stride, left, right };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, a_sum_cap_rate, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, a_sum_cap_rate, heap, size_sq, nullptr, sink);
 }
 
+template<class P>
 Bounds sum::inflate(int src_w, int src_h,
 	ExEdit::PixelYCA const* src_buf, size_t src_stride,
 	i16* dst_buf, bool dst_colored, size_t dst_stride, int a_sum_cap_rate,
-	void* heap, int size_sq, void* alpha_space)
+	void* heap, int size_sq, void* alpha_space, masking::hint* keep_hint, row_sink const* sink)
 {
 	using namespace masking::inflation;
-	return inflate_common([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
-		i16* med_buf = reinterpret_cast<i16*>(alpha_space);
+	return inflate_common<P>([&](int size, mask* mask_buf, size_t mask_stride, void* mask_heap) {
+		auto* med_buf = reinterpret_cast<typename P::type*>(alpha_space);
 		size_t med_stride = (src_w + 1) & (-2);
-		auto [left, right] = mask_v_color(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap,
+		auto [left, right] = mask_v_color<P>(src_w, src_h, size, src_buf, src_stride, mask_buf, mask_stride, mask_heap,
 			med_buf, med_stride);
 
 		return std::tuple{ med_buf, med_stride, left, right };
-	}, src_w, src_h, dst_buf, dst_colored, dst_stride, a_sum_cap_rate, heap, size_sq);
+	}, src_w, src_h, dst_buf, dst_colored, dst_stride, a_sum_cap_rate, heap, size_sq, keep_hint, sink);
 }
+template Bounds sum::inflate<alpha12>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, int, void*, int, void*, masking::hint*, row_sink const*);
+template Bounds sum::inflate<alpha8>(int, int, ExEdit::PixelYCA const*, size_t,
+	i16*, bool, size_t, int, void*, int, void*, masking::hint*, row_sink const*);
 
@@ -13,62 +13,215 @@ THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR I
 #pragma once
 
 #include <cstdint>
+#include <algorithm>
 #include <tuple>
 #include <vector>
+#include <atomic>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 
 
 ////////////////////////////////
 // AviUtl のマルチスレッド関数のラッパー．
 ////////////////////////////////
 inline constinit struct MultiThread {
+	// number of units to process in parallel,
+	// and the number of units that is worth a thread of its own.
+	struct work { int num_parallel, grain = 1; };
+
 	auto operator()(int num_parallel, auto&&... args, auto&& func) const {
-		return (*this)(num_parallel < num_threads(), args..., func);
+		return (*this)(work{ num_parallel }, args..., func);
+	}
+	auto operator()(work w, auto&&... args, auto&& func) const {
+		// use only as many threads as the units are enough for.
+		int const grain = std::max(w.grain, 1);
+		return dispatch(std::min(num_threads(), (w.num_parallel + grain - 1) / grain), args..., func);
+	}
+	auto operator()(bool single_thread, auto&&... args, auto&& func) const {
+		return dispatch(single_thread ? 1 : num_threads(), args..., func);
+	}
+
+	int32_t num_threads() const {
+		return *ptr_num_threads != 0 ? *ptr_num_threads : def_num_threads;
+	}
+
+	// for hosts other than AviUtl; runs the functions on threads of its own.
+	// `num_threads` <= 0 means as many as the hardware supports.
+	void init_standalone(int32_t num_threads) {
+		if (def_num_threads > 0) return;
+
+		def_num_threads = num_threads > 0 ? num_threads :
+			std::max<int32_t>(std::thread::hardware_concurrency(), 1);
+		standalone_num_threads = def_num_threads;
+		exec_multi_thread_func = &exec_standalone;
+		ptr_num_threads = &standalone_num_threads;
+	}
+
+	// hands out contiguous chunks of rows to the threads on demand,
+	// so adjacent rows stay on one thread and cheap rows don't leave the others idle.
+	// each thread receives its rows in increasing order.
+	class chunks {
+		std::atomic_int next = 0;
+		int const num, size;
+	public:
+		chunks(MultiThread const& mt, int num)
+			: num{ num }, size{ std::max(num / (8 * mt.num_threads()), 1) } {}
+		// fetches the next range [begin, end) of rows; returns false if exhausted.
+		bool fetch(int& begin, int& end) {
+			begin = next.fetch_add(size, std::memory_order_relaxed);
+			if (begin >= num) return false;
+			end = std::min(begin + size, num);
+			return true;
+		}
+	};
+
+	// while alive, every call from this thread runs on this thread alone.
+	// for small objects, dispatching to other threads costs more than the work itself.
+	class serial_scope {
+		int32_t* depth;
+	public:
+		serial_scope(MultiThread const& mt, bool enable) : depth{ enable ? &serial_depth : nullptr } {
+			if (depth != nullptr) ++*depth;
+		}
+		~serial_scope() { if (depth != nullptr) --*depth; }
+		serial_scope(serial_scope const&) = delete;
+		serial_scope& operator=(serial_scope const&) = delete;
+	};
+
+	// runs `count` independent jobs, `job(i)`, sharing the threads among them.
+	// each job takes a single thread with its nested calls serialized,
+	// except those of `cost(i)` no less than `split_cost`, which run one by one across the threads.
+	void batch(int count, auto&& cost, int split_cost, auto&& job) const
+	{
+		std::atomic_int next = 0;
+		(*this)(count, [&](int thread_id, int thread_num) {
+			serial_scope const serial{ *this, true };
+			for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+				if (cost(i) < split_cost) job(i);
+		});
+		for (int i = 0; i < count; i++)
+			if (cost(i) >= split_cost) job(i);
 	}
-	auto operator()(bool single_thread, auto&&... args, auto&& func) const
+
+private:
+	auto dispatch(int num_workers, auto&&... args, auto&& func) const
 	{
 		using RetT = std::invoke_result_t<decltype(func), int, int, decltype(args)...>;
-		if (single_thread) {
+		if (num_workers <= 1 || serial_depth > 0) {
 			if constexpr (std::is_void_v<RetT>)
 				return func(0, 1, args...);
 			else return std::vector<RetT>{ func(0, 1, args...) };
 		}
 
-		auto cxt = std::tuple{ &func, &args... };
-		constexpr auto invoke = [](auto& cxt, auto... params) {
+		// threads beyond `num_workers` return immediately.
+		auto cxt = std::tuple{ num_workers, &func, &args... };
+		static constexpr auto invoke = [](auto& cxt, auto... params) {
 			return [&]<size_t... I>(std::index_sequence<I...>) {
-				return (*std::get<0>(cxt))(params..., *std::get<1 + I>(cxt)...);
+				return (*std::get<1>(cxt))(params..., *std::get<2 + I>(cxt)...);
 			}(std::make_index_sequence<sizeof...(args)>{});
 		};
 
 		if constexpr (std::is_void_v<RetT>) {
 			exec_multi_thread_func([](int thread_id, int thread_num, void* param1, void*) {
-				invoke(*reinterpret_cast<decltype(cxt)*>(param1), thread_id, thread_num);
+				auto& c = *reinterpret_cast<decltype(cxt)*>(param1);
+				if (int const n = std::get<0>(c); thread_id < n)
+					invoke(c, thread_id, n);
 			}, &cxt, nullptr);
 		}
 		else {
-			std::vector<RetT> ret(num_threads());
+			std::vector<RetT> ret(num_workers);
 
 			exec_multi_thread_func([](int thread_id, int thread_num, void* param1, void* param2) {
+				auto& c = *reinterpret_cast<decltype(cxt)*>(param1);
 				// assign the return value to a std::vector<>.
-				(*reinterpret_cast<decltype(ret)*>(param2))[thread_id]
-					= invoke(*reinterpret_cast<decltype(cxt)*>(param1), thread_id, thread_num);
+				if (int const n = std::get<0>(c); thread_id < n)
+					(*reinterpret_cast<decltype(ret)*>(param2))[thread_id] = invoke(c, thread_id, n);
 			}, &cxt, &ret);
 
 			return ret;
 		}
 	}
 
-	int32_t num_threads() const {
-		return *ptr_num_threads != 0 ? *ptr_num_threads : def_num_threads;
-	}
-
-private:
 	//decltype(AviUtl::ExFunc::exec_multi_thread_func) exec_multi_thread_func = nullptr;
 	int32_t (*exec_multi_thread_func)(void(*func)(int thread_id, int thread_num, void* param1, void* param2), void* param1, void* param2) = nullptr;
 	int32_t* ptr_num_threads = nullptr; // 0x086384
 	int32_t def_num_threads = 0;
+	static inline thread_local int32_t serial_depth = 0;
+
+	static inline int32_t standalone_num_threads = 0;
+	using exec_func = void(*)(int thread_id, int thread_num, void* param1, void* param2);
+
+	// threads parked between the calls, as the kernels call several times per pass
+	// and creating the threads anew each time costs more than the smaller calls themselves.
+	class standalone_pool {
+		std::atomic_bool busy = false;
+		std::mutex mtx;
+		std::condition_variable cv_start, cv_done;
+		uint64_t generation = 0;
+		int pending = 0;
+		exec_func func = nullptr; void* param1 = nullptr; void* param2 = nullptr;
+
+		void work(int thread_id, int thread_num)
+		{
+			for (uint64_t seen = 0;;) {
+				std::unique_lock lock{ mtx };
+				cv_start.wait(lock, [&] { return generation != seen; });
+				seen = generation;
+				auto const [f, p1, p2] = std::tuple{ func, param1, param2 };
+				lock.unlock();
+
+				f(thread_id, thread_num, p1, p2);
+
+				lock.lock();
+				if (--pending == 0) cv_done.notify_one();
+			}
+		}
+
+	public:
+		explicit standalone_pool(int thread_num)
+		{
+			// the threads live as long as the process.
+			for (int i = 1; i < thread_num; i++)
+				std::thread{ [this, i, thread_num] { work(i, thread_num); } }.detach();
+		}
+
+		// returns false without running `f` if the threads are already running another call,
+		// which happens when called from within `f` or from another thread at the same time.
+		bool run(int thread_num, exec_func f, void* p1, void* p2)
+		{
+			if (busy.exchange(true, std::memory_order_acquire)) return false;
+			{
+				std::lock_guard lock{ mtx };
+				func = f; param1 = p1; param2 = p2;
+				pending = thread_num - 1;
+				generation++;
+			}
+			cv_start.notify_all();
+
+			f(0, thread_num, p1, p2);
+
+			{
+				std::unique_lock lock{ mtx };
+				cv_done.wait(lock, [&] { return pending == 0; });
+			}
+			busy.store(false, std::memory_order_release);
+			return true;
+		}
+	};
+	static int32_t exec_standalone(exec_func func, void* param1, void* param2)
+	{
+		int const n = standalone_num_threads;
+		// never destroyed, as the threads wait on it until the process ends.
+		static standalone_pool* const pool = new standalone_pool{ n };
+		if (pool->run(n, func, param1, param2)) return 1;
+
+		std::vector<std::thread> threads; threads.reserve(n - 1);
+		for (int i = 1; i < n; i++) threads.emplace_back(func, i, n, param1, param2);
+		func(0, n, param1, param2);
+		for (auto& th : threads) th.join();
+		return 1;
+	}
 
 	friend struct ExEdit092;
 	void init(decltype(exec_multi_thread_func) mt_func, int32_t* num_threads) {
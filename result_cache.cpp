@@ -0,0 +1,379 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "multi_thread.hpp"
+#include "result_cache.hpp"
+
+namespace fs = std::filesystem;
+using namespace Calculation;
+
+
+////////////////////////////////
+// ファイル形式．
+////////////////////////////////
+namespace
+{
+	// each file holds a result of morphology, named after its key:
+	// the header, the meta data padded to 4 bytes, the indices past the runs of each row,
+	// and then the runs of the alpha values in the region told by the header.
+	constexpr char magic[4] = { 'C', 'B', 'S', '1' };
+	constexpr char const* extension = ".alpha";
+
+	struct file_header {
+		char magic[4];
+		uint32_t meta_size;
+		int32_t L, T, R, B;
+		uint32_t run_count;
+	};
+	struct run {
+		uint16_t len;
+		int16_t val;
+	};
+	static_assert(sizeof(file_header) % 4 == 0 && sizeof(run) == 4);
+
+	constexpr size_t align4(size_t size) { return (size + 3) & ~size_t{ 3 }; }
+
+	// maps the entire file read-only, or nothing if unavailable.
+	class mapped_file {
+		std::byte const* view = nullptr;
+		size_t len = 0;
+
+	public:
+		explicit mapped_file(fs::path const& path)
+		{
+		#ifdef _WIN32
+			HANDLE const file = ::CreateFileW(path.c_str(), GENERIC_READ,
+				FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE) return;
+			if (LARGE_INTEGER size; ::GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+				if (HANDLE const mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+					mapping != nullptr) {
+					view = static_cast<std::byte const*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+					if (view != nullptr) len = static_cast<size_t>(size.QuadPart);
+					::CloseHandle(mapping);
+				}
+			}
+			::CloseHandle(file);
+		#else
+			int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) return;
+			if (struct stat st; ::fstat(fd, &st) == 0 && st.st_size > 0) {
+				void* const p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (p != MAP_FAILED) {
+					view = static_cast<std::byte const*>(p);
+					len = static_cast<size_t>(st.st_size);
+				}
+			}
+			::close(fd);
+		#endif
+		}
+		~mapped_file()
+		{
+			if (view == nullptr) return;
+		#ifdef _WIN32
+			::UnmapViewOfFile(view);
+		#else
+			::munmap(const_cast<std::byte*>(view), len);
+		#endif
+		}
+		mapped_file(mapped_file const&) = delete;
+		mapped_file& operator=(mapped_file const&) = delete;
+
+		std::span<std::byte const> bytes() const { return { view, len }; }
+	};
+
+	// a non-cryptographic hash of two independent lanes.
+	struct hasher {
+		uint64_t h0 = 0x243f6a8885a308d3, h1 = 0x13198a2e03707344;
+
+		void add(uint64_t v)
+		{
+			h0 = std::rotl(h0 ^ (v * 0x9e3779b97f4a7c15), 29) * 0xbf58476d1ce4e5b9;
+			h1 = std::rotl(h1 + (v ^ 0xc2b2ae3d27d4eb4f), 37) * 0x94d049bb133111eb;
+		}
+		void add(Filter::Cache::key const& k) { add(k[0]); add(k[1]); }
+
+		Filter::Cache::key digest() const
+		{
+			constexpr auto mix = [](uint64_t x) {
+				x ^= x >> 33; x *= 0xff51afd7ed558ccd;
+				x ^= x >> 33; x *= 0xc4ceb9fe1a85ec53;
+				x ^= x >> 33; return x;
+			};
+			return { mix(h0 ^ std::rotl(h1, 17)), mix(h1 + h0) };
+		}
+	};
+}
+
+
+////////////////////////////////
+// キャッシュの管理．
+////////////////////////////////
+namespace
+{
+	std::atomic_bool active = false;
+	std::mutex mtx; // guards the followings, and the eviction.
+	fs::path cache_dir;
+	uint64_t max_total = 0, total = 0;
+	uint64_t salt = 0;
+	std::atomic_uint64_t tmp_count = 0;
+
+	std::string to_hex(uint64_t val)
+	{
+		constexpr char digits[] = "0123456789abcdef";
+		std::string ret(16, '0');
+		for (int i = 16; --i >= 0; val >>= 4) ret[i] = digits[val & 15];
+		return ret;
+	}
+	fs::path path_of(Filter::Cache::key const& k)
+	{
+		return cache_dir / (to_hex(k[0]) + to_hex(k[1]) + extension);
+	}
+
+	// recounts the total size, and if it exceeds the bound, removes the files
+	// in the least recently used order until it gets to 3/4 of the bound.
+	// assumes `mtx` is locked.
+	void evict()
+	{
+		struct item { fs::file_time_type time; uint64_t size; fs::path path; };
+		std::vector<item> items;
+		uint64_t sum = 0;
+		try {
+			for (auto const& e : fs::directory_iterator{ cache_dir }) {
+				if (e.path().extension() != extension) continue;
+				std::error_code ec_size, ec_time;
+				auto const size = e.file_size(ec_size);
+				auto const time = e.last_write_time(ec_time);
+				if (ec_size || ec_time) continue;
+				items.push_back({ time, size, e.path() });
+				sum += size;
+			}
+		}
+		catch (fs::filesystem_error const&) {}
+
+		total = sum;
+		if (sum <= max_total) return;
+
+		std::sort(items.begin(), items.end(), [](auto& l, auto& r) { return l.time < r.time; });
+		for (auto const& it : items) {
+			if (sum <= max_total / 4 * 3) break;
+			if (std::error_code ec; fs::remove(it.path, ec)) sum -= it.size;
+		}
+		total = sum;
+	}
+	void account(uint64_t size)
+	{
+		std::lock_guard lock{ mtx };
+		total += size;
+		if (total > max_total) evict();
+	}
+}
+
+bool Filter::Cache::setup(fs::path const& dir, uint64_t max_bytes)
+{
+	std::lock_guard lock{ mtx };
+	active = false;
+	if (max_bytes == 0) return false;
+
+	std::error_code ec;
+	fs::create_directories(dir, ec);
+	if (!fs::is_directory(dir, ec)) return false;
+
+	cache_dir = dir;
+	max_total = max_bytes;
+	salt = (uint64_t{ std::random_device{}() } << 32) ^ std::random_device{}();
+	evict();
+
+	active = true;
+	return true;
+}
+
+bool Filter::Cache::enabled()
+{
+	return active.load(std::memory_order_relaxed);
+}
+
+
+////////////////////////////////
+// キーの計算．
+////////////////////////////////
+Filter::Cache::key Filter::Cache::make_key(char tag, std::initializer_list<int32_t> args, size_t meta_size, frame const& fr)
+{
+	// the rows are hashed in bands of the fixed height,
+	// so the key doesn't depend on the number of threads.
+	constexpr int band_h = 32;
+	int const w = fr.obj_w, h = fr.obj_h, bands = (h + band_h - 1) / band_h;
+	std::vector<key> parts(bands);
+
+	MultiThread::chunks chunks{ multi_thread, bands };
+	multi_thread(bands, [&](int thread_id, int thread_num) {
+		for (int b0, b1; chunks.fetch(b0, b1);) for (int b = b0; b < b1; b++) {
+			hasher hs{};
+			int const y1 = std::min((b + 1) * band_h, h);
+			for (int y = b * band_h; y < y1; y++) {
+				auto src = fr.obj_edit + y * fr.obj_line;
+				int x = w;
+				for (; x >= 4; x -= 4, src += 4)
+					hs.add(uint64_t{ static_cast<uint16_t>(src[0].a) } | uint64_t{ static_cast<uint16_t>(src[1].a) } << 16
+						| uint64_t{ static_cast<uint16_t>(src[2].a) } << 32 | uint64_t{ static_cast<uint16_t>(src[3].a) } << 48);
+				if (x > 0) {
+					uint64_t v = 0;
+					for (int i = 0; i < x; i++) v |= uint64_t{ static_cast<uint16_t>(src[i].a) } << (16 * i);
+					hs.add(v);
+				}
+			}
+			parts[b] = hs.digest();
+		}
+	});
+
+	hasher hs{};
+	hs.add(static_cast<uint64_t>(tag));
+	hs.add(meta_size);
+	for (auto a : args) hs.add(static_cast<uint32_t>(a));
+	for (int v : { w, h, fr.max_w, fr.max_h }) hs.add(static_cast<uint32_t>(v));
+	for (auto const& p : parts) hs.add(p);
+	return hs.digest();
+}
+
+
+////////////////////////////////
+// 読み込み・書き出し．
+////////////////////////////////
+bool Filter::Cache::load(key const& k, void* meta, size_t meta_size, std::function<plane()> const& plane_of)
+{
+	auto const path = path_of(k);
+	{
+		mapped_file const file{ path };
+		auto const bytes = file.bytes();
+		if (bytes.size() < sizeof(file_header)) return false;
+
+		file_header hd;
+		std::memcpy(&hd, bytes.data(), sizeof(hd));
+		if (std::memcmp(hd.magic, magic, sizeof(magic)) != 0 || hd.meta_size != meta_size) return false;
+		Bounds const bd{ hd.L, hd.T, hd.R, hd.B };
+		int const ht = bd.is_empty() ? 0 : bd.ht(), wd = bd.is_empty() ? 0 : bd.wd();
+		size_t const ofs_rows = sizeof(file_header) + align4(meta_size),
+			ofs_runs = ofs_rows + sizeof(uint32_t) * ht;
+		if (bytes.size() != ofs_runs + sizeof(run) * hd.run_count) return false;
+
+		// the alpha values go where the restored meta data tells.
+		std::memcpy(meta, bytes.data() + sizeof(file_header), meta_size);
+		auto const pl = plane_of();
+		if (pl.bd.is_empty() ? ht > 0 :
+			pl.bd.L != bd.L || pl.bd.T != bd.T || pl.bd.R != bd.R || pl.bd.B != bd.B) return false;
+
+		// the mapping is aligned to a page, and so are these to 4 bytes.
+		auto const row_ends = reinterpret_cast<uint32_t const*>(bytes.data() + ofs_rows);
+		auto const runs = reinterpret_cast<run const*>(bytes.data() + ofs_runs);
+		std::atomic_bool broken = false;
+		MultiThread::chunks rows{ multi_thread, ht };
+		if (ht > 0) multi_thread(ht, [&](int thread_id, int thread_num) {
+			for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+				uint32_t i = y == 0 ? 0 : row_ends[y - 1];
+				uint32_t const end = row_ends[y];
+				if (i > end || end > hd.run_count) { broken = true; return; }
+
+				auto dst = pl.buf + bd.L * pl.step + (bd.T + y) * pl.stride;
+				int left = wd;
+				for (; i < end; i++) {
+					int const len = runs[i].len;
+					if (len > left) { broken = true; return; }
+					left -= len;
+					for (int x = len; --x >= 0; dst += pl.step) *dst = runs[i].val;
+				}
+				if (left != 0) { broken = true; return; }
+			}
+		});
+		if (broken) return false;
+	}
+
+	// mark it as recently used.
+	std::error_code ec;
+	fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+	return true;
+}
+
+void Filter::Cache::store(key const& k, void const* meta, size_t meta_size, plane const& pl)
+{
+	int const ht = pl.bd.is_empty() ? 0 : pl.bd.ht(), wd = pl.bd.is_empty() ? 0 : pl.bd.wd();
+	std::vector<uint32_t> row_ends(ht);
+	std::vector<run> runs;
+	for (int y = 0; y < ht; y++) {
+		auto src = pl.buf + pl.bd.L * pl.step + (pl.bd.T + y) * pl.stride;
+		for (int x = wd; x > 0;) {
+			int16_t const val = *src;
+			int len = 0;
+			do { src += pl.step; len++; } while (len < x && len < 0xffff && *src == val);
+			runs.push_back({ static_cast<uint16_t>(len), val });
+			x -= len;
+		}
+		row_ends[y] = static_cast<uint32_t>(runs.size());
+	}
+
+	file_header hd{
+		.meta_size = static_cast<uint32_t>(meta_size),
+		.L = pl.bd.L, .T = pl.bd.T, .R = pl.bd.R, .B = pl.bd.B,
+		.run_count = static_cast<uint32_t>(runs.size()),
+	};
+	std::memcpy(hd.magic, magic, sizeof(magic));
+	if (ht == 0) hd.L = hd.T = hd.R = hd.B = 0;
+
+	// write to a temporary file first, so no one would see it incomplete.
+	auto const path = path_of(k);
+	auto tmp = path;
+	tmp += "." + to_hex(salt ^ tmp_count.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+	{
+		constexpr char pad[4]{};
+		std::ofstream file{ tmp, std::ios::binary };
+		file.write(reinterpret_cast<char const*>(&hd), sizeof(hd));
+		file.write(static_cast<char const*>(meta), meta_size);
+		file.write(pad, align4(meta_size) - meta_size);
+		file.write(reinterpret_cast<char const*>(row_ends.data()), sizeof(uint32_t) * row_ends.size());
+		file.write(reinterpret_cast<char const*>(runs.data()), sizeof(run) * runs.size());
+		if (!file.flush()) {
+			file.close();
+			std::error_code ec;
+			fs::remove(tmp, ec);
+			return;
+		}
+	}
+	std::error_code ec;
+	fs::rename(tmp, path, ec);
+	if (ec) {
+		fs::remove(tmp, ec);
+		return;
+	}
+	account(sizeof(hd) + align4(meta_size) + sizeof(uint32_t) * row_ends.size() + sizeof(run) * runs.size());
+}
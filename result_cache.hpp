@@ -0,0 +1,71 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <initializer_list>
+#include <type_traits>
+
+#include "buffer_base.hpp"
+#include "filter_core.hpp"
+
+
+////////////////////////////////
+// 処理結果のディスクキャッシュ．
+////////////////////////////////
+namespace Filter::Cache
+{
+	// enables the cache with the files in `dir`, whose total size is bounded by `max_bytes`.
+	// returns false if the directory is unavailable or `max_bytes` is zero, leaving the cache disabled.
+	bool setup(std::filesystem::path const& dir, uint64_t max_bytes);
+	bool enabled();
+
+	// objects smaller than this are faster to process than to look up.
+	constexpr int min_area = 128 * 128;
+	// whether through() keeps the result for `fr`, which then has to be complete on its plane.
+	inline bool keeps(frame const& fr) { return enabled() && fr.obj_w * fr.obj_h >= min_area; }
+
+	using key = std::array<uint64_t, 2>;
+
+	// where the result of morphology keeps its alpha values.
+	using plane = Calculation::plane;
+
+	// identifies the morphology `tag` with `args` on the image of `fr`,
+	// hashing the alpha values of `fr.obj_edit` and the sizes of the frame.
+	key make_key(char tag, std::initializer_list<int32_t> args, size_t meta_size, frame const& fr);
+	// restores `meta` and then the alpha values onto `plane_of()`, the plane for that `meta`.
+	// returns false if not found, in which case the contents are unspecified.
+	bool load(key const& k, void* meta, size_t meta_size, std::function<plane()> const& plane_of);
+	void store(key const& k, void const* meta, size_t meta_size, plane const& pl);
+
+	// returns the result of `compute(fr)` as it would be, looking it up in the cache first.
+	// `plane_of(result, fr)` tells where the alpha values of `result` are.
+	auto through(char tag, std::initializer_list<int32_t> args, frame& fr,
+		auto&& compute, auto&& plane_of)
+	{
+		using result = decltype(compute(fr));
+		static_assert(std::is_trivially_copyable_v<result>);
+		if (!keeps(fr)) return compute(fr);
+
+		auto const k = make_key(tag, args, sizeof(result), fr);
+		result ret{};
+		if (load(k, &ret, sizeof(ret), [&] { return plane_of(ret, fr); })) return ret;
+
+		ret = compute(fr);
+		store(k, &ret, sizeof(ret), plane_of(ret, fr));
+		return ret;
+	}
+}
@@ -0,0 +1,225 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <exedit/pixel.hpp>
+
+#include "multi_thread.hpp"
+#include "sdf.hpp"
+
+using namespace Calculation;
+using i16 = int16_t;
+using i32 = int32_t;
+using i64 = int64_t;
+using Filter::frame;
+using Filter::Sdf::field;
+
+constexpr i32 far_away = std::numeric_limits<i32>::max();
+
+
+////////////////////////////////
+// 距離変換．
+////////////////////////////////
+
+// squared euclidean distances from each pixel of the `w` by `h` image padded by `pad`
+// to the nearest pixel of the image where `is_site(x, y)` holds, or `far_away` if none.
+// `dst` has the stride of `w + 2 * pad`.
+static void transform(int w, int h, int pad, auto&& is_site, i32* dst)
+{
+	int const dst_w = w + 2 * pad, dst_h = h + 2 * pad;
+
+	// first, the distances to the nearest site within each column, -1 if none.
+	multi_thread(w, [&](int thread_id, int thread_num) {
+		int const x0 = w * thread_id / thread_num, x1 = w * (thread_id + 1) / thread_num;
+		std::vector<int> site(x1 - x0, -1);
+
+		// top -> bottom
+		auto dst_x0 = dst + pad + x0 + pad * dst_w;
+		for (int y = 0; y < h + pad; y++, dst_x0 += dst_w) {
+			auto d = dst_x0;
+			for (int x = x0; x < x1; x++, d++) {
+				auto& s = site[x - x0];
+				if (y < h && is_site(x, y)) s = y;
+				*d = s < 0 ? -1 : y - s;
+			}
+		}
+
+		// top <- bottom
+		std::ranges::fill(site, -1);
+		dst_x0 -= dst_w; dst_x0 -= pad * dst_w;
+		for (int y = h; --y >= -pad; dst_x0 -= dst_w) {
+			auto d = dst_x0;
+			for (int x = x0; x < x1; x++, d++) {
+				auto& s = site[x - x0];
+				if (y < 0) *d = s < 0 ? -1 : s - y;
+				else {
+					if (is_site(x, y)) s = y;
+					if (s >= 0 && (*d < 0 || s - y < *d)) *d = s - y;
+				}
+			}
+		}
+	});
+
+	// then row by row, the lower envelope of the parabolas rooted at those columns.
+	MultiThread::chunks rows{ multi_thread, dst_h };
+	multi_thread(dst_h, [&](int thread_id, int thread_num) {
+		std::vector<int> col(w), root(w);
+		std::vector<double> from(w + 1);
+
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+			auto const dst_y = dst + y * dst_w;
+			std::copy_n(dst_y + pad, w, col.begin());
+
+			auto height = [&](int x) { return static_cast<i64>(col[x]) * col[x] + static_cast<i64>(x) * x; };
+			int k = -1;
+			for (int x = 0; x < w; x++) {
+				if (col[x] < 0) continue;
+				double s = -std::numeric_limits<double>::infinity();
+				for (; k >= 0; k--) {
+					s = static_cast<double>(height(x) - height(root[k])) / (2 * (x - root[k]));
+					if (s > from[k]) break;
+				}
+				if (k < 0) s = -std::numeric_limits<double>::infinity();
+				root[++k] = x; from[k] = s;
+			}
+
+			if (k < 0) {
+				std::fill_n(dst_y, dst_w, far_away);
+				continue;
+			}
+			from[k + 1] = std::numeric_limits<double>::infinity();
+			for (int i = 0, x = -pad; x < w + pad; x++) {
+				while (from[i + 1] < x) i++;
+				int const dx = x - root[i];
+				dst_y[x + pad] = dx * dx + col[root[i]] * col[root[i]];
+			}
+		}
+	});
+}
+
+
+////////////////////////////////
+// 距離場の照合．
+////////////////////////////////
+field* Filter::Sdf::of(frame const& fr, i16 thresh)
+{
+	field* const f = fr.sdf;
+	if (f == nullptr) return nullptr;
+	int const w = fr.obj_w, h = fr.obj_h;
+
+	// keep the field as long as the source is the same.
+	if (f->w == w && f->h == h && f->thresh == thresh) {
+		auto const diffs = multi_thread(h, [&](int thread_id, int thread_num) {
+			int const y0 = h * thread_id / thread_num, y1 = h * (thread_id + 1) / thread_num;
+			for (int y = y0; y < y1; y++) {
+				auto src = fr.obj_edit + y * fr.obj_line;
+				auto prev = f->src.data() + y * w;
+				for (int x = w; --x >= 0; src++, prev++)
+					if (src->a != *prev) return 1;
+			}
+			return 0;
+		});
+		if (std::ranges::all_of(diffs, [](int d) { return d == 0; })) return f;
+	}
+
+	f->w = w; f->h = h; f->thresh = thresh;
+	f->pad = -1; f->has_inside = false;
+	f->src.resize(static_cast<size_t>(w) * h);
+	auto const bounds = multi_thread(h, [&](int thread_id, int thread_num) {
+		int const y0 = h * thread_id / thread_num, y1 = h * (thread_id + 1) / thread_num;
+		int left = w, right = -1;
+		for (int y = y0; y < y1; y++) {
+			auto src = fr.obj_edit + y * fr.obj_line;
+			auto dst = f->src.data() + y * w;
+			for (int x = 0; x < w; x++, src++, dst++) {
+				*dst = src->a;
+				if (*dst > thresh) left = std::min(left, x), right = std::max(right, x);
+			}
+		}
+		return std::pair{ left, right };
+	});
+	std::tie(f->left, f->right) = unite_interval_alt<int>(bounds);
+	return f;
+}
+
+
+////////////////////////////////
+// 距離場からの膨張・収縮．
+////////////////////////////////
+Bounds Filter::Sdf::inflate(field& f, int size_sq,
+	i16* dst_buf, bool dst_colored, size_t dst_stride)
+{
+	int const size = static_cast<int>(std::sqrt(size_sq));
+	if (f.left >= f.right) return { 0, 0, 0, 0 };
+
+	if (f.pad < size) {
+		f.pad = size;
+		f.outside.resize(static_cast<size_t>(f.w + 2 * size) * (f.h + 2 * size));
+		transform(f.w, f.h, size,
+			[&, src = f.src.data(), w = f.w, thresh = f.thresh](int x, int y) { return src[x + y * w] > thresh; },
+			f.outside.data());
+	}
+
+	// write the same columns as bin::inflate() does.
+	int const dst_h = f.h + 2 * size, dst_step = dst_colored ? 4 : 1,
+		stride = f.w + 2 * f.pad, ofs = f.pad - size;
+	MultiThread::chunks rows{ multi_thread, dst_h };
+	auto const bounds = multi_thread(dst_h, [&](int thread_id, int thread_num) {
+		int top = dst_h, bottom = -1;
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+			auto src = f.outside.data() + (ofs + f.left) + (ofs + y) * stride;
+			auto dst = dst_buf + f.left * dst_step + y * dst_stride;
+			bool opaque = false;
+			for (int x = f.right + 2 * size - f.left; --x >= 0; src++, dst += dst_step) {
+				bool const in = *src <= size_sq;
+				*dst = in ? max_alpha : 0;
+				opaque |= in;
+			}
+			if (opaque) { if (bottom < 0) top = bottom = y; else bottom = y; }
+		}
+		return std::pair{ top, bottom };
+	});
+
+	auto const [top, bottom] = unite_interval_alt<int>(bounds);
+	return { f.left, top, f.right + 2 * size, bottom };
+}
+
+Bounds Filter::Sdf::deflate(field& f, int size_sq,
+	i16* dst_buf, bool dst_colored, size_t dst_stride)
+{
+	int const size = static_cast<int>(std::sqrt(size_sq));
+	if (!f.has_inside) {
+		f.has_inside = true;
+		f.inside.resize(static_cast<size_t>(f.w) * f.h);
+		transform(f.w, f.h, 0,
+			[&, src = f.src.data(), w = f.w, thresh = f.thresh](int x, int y) { return src[x + y * w] <= thresh; },
+			f.inside.data());
+	}
+
+	int const dst_w = f.w - 2 * size, dst_h = f.h - 2 * size, dst_step = dst_colored ? 4 : 1;
+	MultiThread::chunks rows{ multi_thread, dst_h };
+	multi_thread(dst_h, [&](int thread_id, int thread_num) {
+		for (int y0, y1; rows.fetch(y0, y1);) for (int y = y0; y < y1; y++) {
+			auto src = f.inside.data() + size + (y + size) * f.w;
+			auto dst = dst_buf + y * dst_stride;
+			for (int x = dst_w; --x >= 0; src++, dst += dst_step)
+				*dst = *src > size_sq ? max_alpha : 0;
+		}
+	});
+
+	return { 0, 0, dst_w, dst_h };
+}
@@ -0,0 +1,54 @@
+/*
+The MIT License (MIT)
+
+Copyright (c) 2024-2025 sigma-axis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "buffer_base.hpp"
+#include "filter_core.hpp"
+
+
+////////////////////////////////
+// 符号付き距離場の共有．
+////////////////////////////////
+namespace Filter::Sdf
+{
+	// the signed distance field of the binarized source, in squared euclidean distances,
+	// so several filters on the same object derive their shapes from one distance transform.
+	class field {
+		int w = 0, h = 0, pad = -1;
+		int16_t thresh = -1;
+		bool has_inside = false;
+		int left = 0, right = 0; // the range of columns with opaque pixels.
+		std::vector<int16_t> src; // the alpha values it was made from.
+		std::vector<int32_t> inside; // to the nearest transparent pixel, `w` by `h`.
+		std::vector<int32_t> outside; // to the nearest opaque pixel, padded by `pad` on each side.
+
+		friend field* of(frame const& fr, int16_t thresh);
+		friend Calculation::Bounds inflate(field& f, int size_sq,
+			int16_t* dst_buf, bool dst_colored, size_t dst_stride);
+		friend Calculation::Bounds deflate(field& f, int size_sq,
+			int16_t* dst_buf, bool dst_colored, size_t dst_stride);
+	};
+
+	// the field attached to `fr`, made from the source of `fr` binarized by `thresh`.
+	// returns nullptr if no field is attached.
+	field* of(frame const& fr, int16_t thresh);
+
+	// the same as bin::inflate() and bin::deflate() on the source that `f` was made from.
+	Calculation::Bounds inflate(field& f, int size_sq,
+		int16_t* dst_buf, bool dst_colored, size_t dst_stride);
+	Calculation::Bounds deflate(field& f, int size_sq,
+		int16_t* dst_buf, bool dst_colored, size_t dst_stride);
+}
@@ -10,31 +10,32 @@ The above copyright notice and this permission notice shall be included in all c
 THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
-#include <cstdint>
+#pragma once
 
-#define NOMINMAX
-#define WIN32_LEAN_AND_MEAN
-using byte = uint8_t;
-#include <exedit/Filter.hpp>
-#include <exedit/Exfunc.hpp>
+#include <cstdint>
+#include <functional>
 
-#include "relative_path.hpp"
+#include <exedit/pixel.hpp>
 
 
 ////////////////////////////////
 // パターン画像の取得．
 ////////////////////////////////
 struct tiled_image {
+	// loads the image into `buffer` of `stride`, no larger than `stride` x `max_h`,
+	// and tells its size. returns false if there's no image to use.
+	using loader = std::function<bool(ExEdit::PixelYCA* buffer, int stride, int max_h, int& w, int& h)>;
+
 	int w = 0, h = 0, ox = 0, oy = 0;
 	ExEdit::PixelYCA* buff = nullptr;
 
 	operator bool() const { return buff != nullptr; }
-	tiled_image(char const* path, int img_x, int img_y, int displace, ExEdit::Filter* efp, void* buffer)
+	tiled_image(loader const& load, int img_x, int img_y, int displace, void* buffer, int stride, int max_h)
 	{
-		if (path == nullptr || path[0] == '\0') return;
+		if (!load) return;
 
 		buff = reinterpret_cast<ExEdit::PixelYCA*>(buffer);
-		if (efp->exfunc->load_image(buff, relative_path::absolute{ path }.abs_path.data(), &w, &h, 0, 0) == 0) {
+		if (!load(buff, stride, max_h, w, h) || w <= 0 || h <= 0) {
 			buff = nullptr;
 			return;
 		}